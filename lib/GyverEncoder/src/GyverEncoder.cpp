@@ -1,6 +1,17 @@
 #include "GyverEncoder.h"
 #include <Arduino.h>
 
+// четверть-шаг по переходу (прошлое положение << 2 | текущее), положение = CLK | DT << 1:
+// -1 налево (11 -> 01 -> 00 -> 10 -> 11), +1 направо, 0 - нет перехода или дребезг через шаг
+static const int8_t _transitions[16] PROGMEM = {
+	0, 1, -1, 0,
+	-1, 0, 0, 1,
+	1, 0, 0, -1,
+	0, -1, 1, 0
+};
+
+Encoder *Encoder::_isrEncoder = NULL;
+
 Encoder::Encoder(uint8_t clk, uint8_t dt, uint8_t sw) {
 	_CLK = clk;
 	_DT = dt;
@@ -127,6 +138,52 @@ boolean Encoder::isHold() {
 	} else return false;
 }
 
+// прерывания
+boolean Encoder::attachInterrupts() {
+	int8_t clk = digitalPinToInterrupt(_CLK);
+	int8_t dt = digitalPinToInterrupt(_DT);
+	if (clk == NOT_AN_INTERRUPT || dt == NOT_AN_INTERRUPT) return false;
+	_isrEncoder = this;
+	_isrState = digitalRead(_CLK) | (digitalRead(_DT) << 1);
+	_steps = 0;
+	flags.enc_isr = true;
+	attachInterrupt(clk, isrHandler, CHANGE);
+	attachInterrupt(dt, isrHandler, CHANGE);
+	return true;
+}
+void Encoder::isrHandler() {
+	_isrEncoder->isr();
+}
+void Encoder::isr() {
+	byte state = digitalRead(_CLK) | (digitalRead(_DT) << 1);
+	_steps += (int8_t)pgm_read_byte(&_transitions[(_isrState << 2) | state]);
+	_isrState = state;
+	
+	// поворот засчитывается в фиксированном положении: 11, у полушагового ещё и 00.
+	// дребезг даёт шаги туда и обратно, которые взаимно сокращаются
+	if (state != 0b11 && (flags.enc_type || state != 0b00)) return;
+	byte event = 0;
+	if (_steps <= -2) event = 1;
+	else if (_steps >= 2) event = 2;
+	_steps = 0;
+	if (!event) return;
+	if (!digitalRead(_SW)) event += 2;
+	
+	byte next = (_head + 1) & (ENC_QUEUE_SIZE - 1);
+	if (next == _tail) {
+		if (_lost < 255) _lost++;
+		return;
+	}
+	_queue[_head] = event;
+	_head = next;
+}
+byte Encoder::lostTurns() {
+	return _lost;
+}
+boolean Encoder::isTurnQueued() {
+	return _head != _tail;
+}
+
 void Encoder::tick() {
   flags.SW_state = !digitalRead(_SW);        // читаем положение кнопки SW
   
@@ -162,6 +219,24 @@ void Encoder::tick() {
     debounce_timer = millis();
   }
 	
+	// повороты из прерывания: по одному за вызов, пока прошлый не прочитан
+	if (flags.enc_isr) {
+		if (encState == 0 && _tail != _head) {
+			encState = _queue[_tail];
+			_tail = (_tail + 1) & (ENC_QUEUE_SIZE - 1);
+			flags.isTurn_f = true;
+			byte direction = encState > 2 ? encState - 2 : encState;
+			if (millis() - fast_timer < (uint32_t)fast_timeout) {
+				if (direction == 1) flags.isFastL_f = true;
+				else flags.isFastR_f = true;
+			}
+			fast_timer = millis();
+			flags.turn_flag = true;
+			debounce_timer = millis();
+		}
+		return;
+	}
+	
 	// читаем состояние энкодера
 	curState = digitalRead(_CLK);
 	curState += digitalRead(_DT) << 1;
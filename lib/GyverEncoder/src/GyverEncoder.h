@@ -12,12 +12,15 @@
 	- Работа с двумя типами экнодеров
 	- Отработка "быстрого поворота"
 	- Версия 3+ более оптимальная и быстрая
+	- Декодирование поворота в прерываниях по таблице переходов (attachInterrupts)
 */
 
 // настройка антидребезга энкодера, кнопки и таймаута удержания
 #define DEBOUNCE_TURN 5
 #define DEBOUNCE_BUTTON 80
 #define HOLD_TIMEOUT 700
+// размер очереди поворотов из прерывания (степень двойки)
+#define ENC_QUEUE_SIZE 8
 
 #pragma pack(push,1)
 typedef struct
@@ -35,6 +38,7 @@ typedef struct
 	bool isFastL_f: 1;
 	bool enc_tick_mode: 1;
 	bool enc_type: 1;
+	bool enc_isr: 1;
 
 } GyverEncoderFlags;
 #pragma pack(pop)
@@ -64,6 +68,11 @@ class Encoder
     boolean isHolded();						// возвращает true при удержании кнопки, сама сбрасывается в false
 	boolean isHold();						// возвращает true при удержании кнопки, НЕ СБРАСЫВАЕТСЯ
 	
+	boolean attachInterrupts();				// декодировать поворот в прерываниях по CLK и DT (пины 2 и 3 на ATmega328), false - на пинах нет прерываний
+	void isr();								// обработка изменения CLK или DT, вызывается из прерывания
+	byte lostTurns();						// сколько поворотов не поместилось в очередь
+	boolean isTurnQueued();					// есть ли в очереди поворот, ещё не отданный tick()
+	
 	int8_t fast_timeout = 50;
 	
   private:
@@ -74,6 +83,14 @@ class Encoder
 	uint32_t debounce_timer = 0, fast_timer;
     byte _CLK = 0, _DT = 0, _SW = 0;
 	
+	// очередь поворотов: пишет только прерывание (_head), читает только tick() (_tail)
+	static void isrHandler();
+	static Encoder *_isrEncoder;
+	volatile byte _queue[ENC_QUEUE_SIZE];
+	volatile byte _head = 0, _tail = 0, _lost = 0;
+	byte _isrState = 0;		// положение CLK/DT в прошлом прерывании
+	int8_t _steps = 0;		// четверть-шаги с прошлого фиксированного положения
+	
 };
 
 #define TYPE1 0			// полушаговый энкодер
@@ -23,7 +23,7 @@ void GTimer_ms::stop() {
 }
 boolean GTimer_ms::isReady() {
 	if (!_state) return false;
-	if ((long)millis() - _timer >= _interval) {
+	if (millis() - _timer >= _interval) {
 		if (_mode) _timer = millis();
 		return true;
 	} else {
@@ -57,7 +57,7 @@ void GTimer_us::stop() {
 }
 boolean GTimer_us::isReady() {
 	if (!_state) return false;
-	if ((long)micros() - _timer >= _interval) {
+	if (micros() - _timer >= _interval) {
 		if (_mode) _timer = micros();
 		return true;
 	} else {
@@ -67,4 +67,55 @@ boolean GTimer_us::isReady() {
 
 void GTimer_us::reset() {
 	_timer = micros();
-}
\ No newline at end of file
+}
+
+// сроки сравниваются по знаку разности, поэтому верно и после переполнения millis(),
+// пока до срока меньше 24 суток
+boolean GScheduler::schedule(GTask task, uint32_t delay) {
+	GScheduler::cancel(task);
+	if (_count == GSCHEDULER_TASKS) return false;
+	uint32_t due = millis() + delay;
+	uint8_t i = _count;
+	for (; i > 0 && (int32_t)(due - _queue[i - 1].due) < 0; --i)
+		_queue[i] = _queue[i - 1];
+	_queue[i].due = due;
+	_queue[i].task = task;
+	_count++;
+	return true;
+}
+void GScheduler::cancel(GTask task) {
+	for (uint8_t i = 0; i < _count; ++i) {
+		if (_queue[i].task == task) {
+			GScheduler::remove(i);
+			return;
+		}
+	}
+}
+boolean GScheduler::isScheduled(GTask task) {
+	for (uint8_t i = 0; i < _count; ++i)
+		if (_queue[i].task == task) return true;
+	return false;
+}
+uint8_t GScheduler::tick() {
+	// не больше задач, чем было в очереди: задача с нулевой задержкой,
+	// поставленная из обработчика, ждёт следующего tick()
+	uint8_t limit = _count, called = 0;
+	uint32_t now = millis();
+	while (called < limit && _count && (int32_t)(now - _queue[0].due) >= 0) {
+		GTask task = _queue[0].task;
+		GScheduler::remove(0);
+		task();
+		called++;
+	}
+	return called;
+}
+uint32_t GScheduler::nextWakeup() {
+	if (!_count) return GSCHEDULER_IDLE;
+	int32_t left = _queue[0].due - millis();
+	return left > 0 ? left : 0;
+}
+void GScheduler::remove(uint8_t index) {
+	_count--;
+	for (uint8_t i = index; i < _count; ++i)
+		_queue[i] = _queue[i + 1];
+}
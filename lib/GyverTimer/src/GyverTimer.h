@@ -8,8 +8,17 @@
 	- Вся работа с таймером заменяется одной функцией
 	- Миллисекундный и микросекундный таймер
 	- Автоматический и ручной режим работы
+	GScheduler - очередь отложенных вызовов вместо опроса нескольких таймеров
+	- Сроки отсортированы, каждый tick() смотрит только на ближайший
+	- Сообщает, сколько осталось до ближайшего срока (можно спать)
+	- Сроки сравниваются по разности, переполнение millis() через 49 суток не мешает
 */
 
+// наибольшее количество задач в очереди GScheduler
+#define GSCHEDULER_TASKS 4
+// nextWakeup() без задач в очереди
+#define GSCHEDULER_IDLE 0xFFFFFFFF
+
 class GTimer_ms
 {
   public:
@@ -48,6 +57,27 @@ class GTimer_us
 	boolean _state = true;
 };
 
+typedef void (*GTask)();
+
+class GScheduler
+{
+  public:
+	boolean schedule(GTask task, uint32_t delay);	// вызвать task через delay мс, если она уже в очереди - перенести. false - очередь полна
+	void cancel(GTask task);				// убрать задачу из очереди
+	boolean isScheduled(GTask task);		// true, если задача ждёт вызова
+	uint8_t tick();							// вызвать задачи, срок которых наступил, возвращает их количество
+	uint32_t nextWakeup();					// мс до ближайшего срока: 0 - уже пора, GSCHEDULER_IDLE - задач нет
+	
+  private:
+	struct Entry {
+		uint32_t due;
+		GTask task;
+	};
+	void remove(uint8_t index);
+	Entry _queue[GSCHEDULER_TASKS];			// по возрастанию срока
+	uint8_t _count = 0;
+};
+
 #define MANUAL 0
 #define AUTO 1
 
@@ -0,0 +1,154 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+/*
+    Заменитель ядра Arduino для сборки на ПК (env:native).
+    Время виртуальное и идёт только по командам симулятора (см. sim.h),
+    аналоговые входы подключены к модели фоторезистора.
+*/
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// Аналоговые входы Arduino Nano
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define NUM_DIGITAL_PINS 22
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+class __FlashStringHelper;
+#define F(string_literal) \
+    (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define constrain(amt, low, high) \
+    ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+
+#define interrupts()
+#define noInterrupts()
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+// Внешние прерывания как на ATmega328: INT0 - пин 2, INT1 - пин 3.
+// Обработчик вызывается из sim_setPin() при смене уровня
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) \
+    ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) {
+        return write((const uint8_t *)str, strlen(str));
+    }
+    virtual int availableForWrite() { return 0; }
+
+    size_t print(const __FlashStringHelper *str);
+    size_t print(const char *str) { return write(str); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &value) {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(const T &value, int format) {
+        size_t n = print(value, format);
+        return n + println();
+    }
+
+  private:
+    size_t printNumber(unsigned long value, uint8_t base);
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+// Порт с виртуальной скоростью: буфер передачи на SERIAL_TX_BUFFER_SIZE
+// байт опустошается со скоростью baud/10 байт в секунду виртуального
+// времени, запись в полный буфер ждёт (двигая часы), как на плате
+#define SERIAL_TX_BUFFER_SIZE 64
+#define SERIAL_RX_BUFFER_SIZE 64
+
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long baud);
+    void end() {}
+    void flush();
+    int available() override;
+    int read() override;
+    int peek() override;
+    int availableForWrite() override;
+    size_t write(uint8_t c) override;
+    using Print::write;
+    operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
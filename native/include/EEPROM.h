@@ -0,0 +1,36 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <Arduino.h>
+
+// EEPROM ATmega328 (1 КБ), после "прошивки" заполнена 0xFF
+#define E2END 0x3FF
+
+struct EEPROMClass {
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    void update(int address, uint8_t value);
+    uint16_t length() { return E2END + 1; }
+
+    template <typename T>
+    T &get(int address, T &value) {
+        uint8_t *p = (uint8_t *)&value;
+        for (size_t i = 0; i < sizeof(T); ++i)
+            p[i] = read(address + i);
+        return value;
+    }
+
+    template <typename T>
+    const T &put(int address, const T &value) {
+        const uint8_t *p = (const uint8_t *)&value;
+        for (size_t i = 0; i < sizeof(T); ++i)
+            update(address + i, p[i]);
+        return value;
+    }
+
+    uint32_t writes = 0;  // количество реальных записей (износ)
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
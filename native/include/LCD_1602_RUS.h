@@ -0,0 +1,36 @@
+#ifndef LCD_1602_RUS_h
+#define LCD_1602_RUS_h
+
+#include <LiquidCrystal_I2C.h>
+
+/*
+    Заглушка LCD_1602_RUS для сборки на ПК.
+    Буквы, похожие на латинские, выводятся латиницей, как в библиотеке,
+    остальная кириллица - как '?', но учитывается занятость 8 ячеек CGRAM:
+    каждая новая буква после clear() стоит записи 8 байт в CGRAM, а девятая
+    различная буква засчитывается как переполнение (на настоящем экране
+    она испортила бы уже выведенные символы).
+*/
+
+class LCD_1602_RUS : public LiquidCrystal_I2C {
+  public:
+    LCD_1602_RUS(uint8_t address, uint8_t cols, uint8_t rows);
+
+    void clear();
+    void setCursor(uint8_t col, uint8_t row);
+    uint8_t getCursorCol();
+    uint8_t getCursorRow();
+
+    void print(const wchar_t *str);
+    using Print::print;
+
+    uint32_t glyphOverflows = 0;
+    uint32_t clears = 0;  // по ним видны полные перерисовки LcdFramebuffer
+
+  private:
+    uint8_t _col = 0, _row = 0;
+    wchar_t _glyphs[8];
+    uint8_t _glyph_count = 0;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef LiquidCrystal_I2C_h
+#define LiquidCrystal_I2C_h
+
+#include <Arduino.h>
+
+/*
+    Заглушка экрана 1602 на PCF8574 для сборки на ПК.
+    Хранит содержимое DDRAM и считает байты, которые ушли бы на экран:
+    символы (data) и команды (clear, setCursor, ...). На настоящем
+    переходнике каждый такой байт - 4 байта по I2C.
+*/
+
+class LiquidCrystal_I2C : public Print {
+  public:
+    LiquidCrystal_I2C(uint8_t address, uint8_t cols, uint8_t rows);
+
+    void init();
+    void begin();
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    void backlight();
+    void noBacklight();
+    void createChar(uint8_t location, const uint8_t charmap[]);
+    void command(uint8_t value);
+    size_t write(uint8_t value) override;
+    using Print::write;
+
+    const char *row(uint8_t index);  // содержимое видимой части строки
+
+    uint32_t dataBytes = 0;
+    uint32_t commandBytes = 0;
+
+  protected:
+    uint8_t _cols, _rows;
+    uint8_t _address_counter = 0;
+    char _ddram[2][41];
+    char _visible[2][17];
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef TwoWire_h
+#define TwoWire_h
+
+// Шина I2C на ПК не нужна: экран подменяется заглушкой LiquidCrystal_I2C
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <Arduino.h>
+
+/*
+    Управление симуляцией для сборки на ПК.
+    - Виртуальные часы: время идёт только через sim_advance(), delay() и
+      ожидание места в буфере Serial, поэтому симуляция детерминирована и
+      может идти намного быстрее реального времени
+    - Модель фоторезисторов (A0-A3, у каждого своя цель под общими
+      светодиодами) в нижнем плече делителя: уровень АЦП =
+      1023 * x / (1 + x), x = (освещённость / 300)^-0.7, где
+      освещённость = фон + сумма (яркость включённого светодиода *
+      отражение цели в его цвете / 255). Сигнал стремится к этому уровню
+      экспоненциально с постоянной времени tau, плюс равномерный шум
+    - Сценарий - текстовый файл, строки "<секунда> <команда> <аргументы>":
+        color <r> <g> <b>        отражение цели всех датчиков (0-255)
+        head <n> <r> <g> <b>     отражение цели датчика n (0-3, пин A0+n)
+        ambient <level>          фоновая освещённость (отн. ед.)
+        led <n> <pin> <gain> [h] светодиод n (0-7, цвет n % 4: красный,
+                                 зелёный, синий, белый): пин и яркость,
+                                 h - светит только на датчик h (по
+                                 умолчанию на все)
+        tau <ms>                 постоянная времени фоторезистора
+        noise <lsb>              амплитуда шума (ед. АЦП)
+        pin <pin> <0|1>          уровень на цифровом входе (кнопки, энкодер),
+                                 на пинах 2 и 3 - с вызовом прерывания
+        serial <text>            строка, принятая по Serial (с '\n'),
+                                 \xHH - произвольный байт
+      События идут в порядке возрастания времени, пустые строки и строки
+      с '#' пропускаются
+*/
+
+// Количество светодиодов в модели
+const uint8_t SIM_LEDS = 8;
+// Количество цветов светодиодов
+const uint8_t SIM_LED_COLORS = 4;
+// Количество датчиков в модели
+const uint8_t SIM_HEADS = 4;
+// Светодиод светит на все датчики
+const uint8_t SIM_ALL_HEADS = 0xFF;
+
+void sim_advance(uint32_t us);          // сдвинуть виртуальное время
+uint64_t sim_time();                    // виртуальное время, мкс (без переполнения)
+void sim_setUptime(uint64_t us);        // сдвиг millis()/micros() от начала симуляции
+
+boolean sim_loadScenario(const char *path);
+void sim_runScenario();                 // применить события, время которых пришло
+
+void sim_setColor(uint8_t r, uint8_t g, uint8_t b);
+void sim_setHeadColor(uint8_t head, uint8_t r, uint8_t g, uint8_t b);
+void sim_setAmbient(uint16_t level);
+void sim_setLed(uint8_t index, uint8_t pin, uint16_t gain,
+                uint8_t head = SIM_ALL_HEADS);
+void sim_setTau(uint16_t ms);
+void sim_setNoise(uint8_t lsb);
+void sim_setPin(uint8_t pin, uint8_t level);
+void sim_serialInput(const char *text);  // \xHH - произвольный байт
+double sim_ledOnSeconds();              // время горения светодиодов, с (сумма
+                                        // по всем, с учётом скважности)
+
+// Что было отправлено через Serial
+void sim_setSerialEcho(boolean echo);   // дублировать вывод в stdout
+uint32_t sim_serialBytes();             // всего байтов отправлено
+uint32_t sim_serialReadings();          // пакетов с цветом (текст и двоичные)
+const char *sim_serialLastLine();       // последняя текстовая строка, без "\r\n"
+
+#endif
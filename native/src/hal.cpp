@@ -0,0 +1,479 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "serial_batch.hpp"
+#include "serial_frame.hpp"
+#include "sim.h"
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+static uint64_t sim_now_us = 0;
+// Время работы платы к началу симуляции, только для millis() и micros()
+static uint64_t sim_uptime_us = 0;
+
+static void sim_accountLeds(uint32_t us);
+
+void sim_advance(uint32_t us) {
+    sim_accountLeds(us);
+    sim_now_us += us;
+}
+
+uint64_t sim_time() { return sim_now_us; }
+
+void sim_setUptime(uint64_t us) { sim_uptime_us = us; }
+
+unsigned long millis() {
+    return (unsigned long)((sim_uptime_us + sim_now_us) / 1000) & 0xFFFFFFFFUL;
+}
+
+unsigned long micros() {
+    return (unsigned long)(sim_uptime_us + sim_now_us) & 0xFFFFFFFFUL;
+}
+
+void delay(unsigned long ms) { sim_advance(ms * 1000); }
+
+void delayMicroseconds(unsigned int us) { sim_advance(us); }
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// ---- Цифровые выводы ----
+
+static uint8_t pin_levels[NUM_DIGITAL_PINS];
+static uint8_t pin_pwm[NUM_DIGITAL_PINS];
+static boolean pins_ready = false;
+
+static void pins_init() {
+    if (pins_ready)
+        return;
+    // Входы кнопок подтянуты к питанию
+    for (uint8_t i = 0; i < NUM_DIGITAL_PINS; ++i)
+        pin_levels[i] = HIGH;
+    pins_ready = true;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    pins_init();
+    if (pin < NUM_DIGITAL_PINS && mode == OUTPUT)
+        pin_levels[pin] = LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    pins_init();
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+    pin_levels[pin] = value ? HIGH : LOW;
+    pin_pwm[pin] = value ? 255 : 0;
+}
+
+int digitalRead(uint8_t pin) {
+    pins_init();
+    return pin < NUM_DIGITAL_PINS ? pin_levels[pin] : LOW;
+}
+
+void analogWrite(uint8_t pin, int value) {
+    pins_init();
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+    value = constrain(value, 0, 255);
+    pin_pwm[pin] = value;
+    pin_levels[pin] = value ? HIGH : LOW;
+}
+
+// Обработчики INT0 и INT1 и условия их вызова
+static void (*pin_handlers[2])();
+static int pin_handler_modes[2];
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode) {
+    if (interrupt < 2) {
+        pin_handlers[interrupt] = handler;
+        pin_handler_modes[interrupt] = mode;
+    }
+}
+
+void detachInterrupt(uint8_t interrupt) {
+    if (interrupt < 2)
+        pin_handlers[interrupt] = NULL;
+}
+
+void sim_setPin(uint8_t pin, uint8_t level) {
+    pins_init();
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+    uint8_t previous = pin_levels[pin];
+    pin_levels[pin] = level ? HIGH : LOW;
+    int interrupt = digitalPinToInterrupt(pin);
+    if (interrupt == NOT_AN_INTERRUPT || !pin_handlers[interrupt] ||
+        previous == pin_levels[pin])
+        return;
+    int mode = pin_handler_modes[interrupt];
+    if (mode == CHANGE || (mode == RISING && pin_levels[pin] == HIGH) ||
+        (mode == FALLING && pin_levels[pin] == LOW))
+        pin_handlers[interrupt]();
+}
+
+// ---- Модель фоторезистора ----
+
+// Цвет светодиода n - n % SIM_LED_COLORS
+static struct {
+    uint8_t pin;
+    uint16_t gain;
+    uint8_t head;
+} sim_leds[SIM_LEDS] = {{6, 800, SIM_ALL_HEADS},  {7, 800, SIM_ALL_HEADS},
+                        {8, 800, SIM_ALL_HEADS},  {0xFF, 0, SIM_ALL_HEADS},
+                        {0xFF, 0, SIM_ALL_HEADS}, {0xFF, 0, SIM_ALL_HEADS},
+                        {0xFF, 0, SIM_ALL_HEADS}, {0xFF, 0, SIM_ALL_HEADS}};
+
+// Каждый датчик смотрит на свою цель и сам по себе инерционен
+static uint8_t sim_reflectance[SIM_HEADS][SIM_LED_COLORS] = {
+    {128, 128, 128, 128}, {128, 128, 128, 128},
+    {128, 128, 128, 128}, {128, 128, 128, 128}};
+static uint16_t sim_ambient = 60;
+static uint16_t sim_tau_ms = 15;
+static uint8_t sim_noise = 1;
+static double sim_level[SIM_HEADS] = {1023, 1023, 1023, 1023};
+
+// Параметры фоторезистора
+static const double SIM_LDR_GAMMA = 0.7;
+static const double SIM_LDR_MIDPOINT = 300;
+static uint64_t sim_level_time[SIM_HEADS] = {};
+// Время горения светодиодов модели (сумма по светодиодам со скважностью)
+static double sim_led_us = 0;
+static uint32_t sim_random_state = 0x12345678;
+
+void sim_setHeadColor(uint8_t head, uint8_t r, uint8_t g, uint8_t b) {
+    if (head >= SIM_HEADS)
+        return;
+    sim_reflectance[head][0] = r;
+    sim_reflectance[head][1] = g;
+    sim_reflectance[head][2] = b;
+    // Четвёртый (белый) светодиод видит среднюю яркость
+    sim_reflectance[head][3] = (r + g + b) / 3;
+}
+
+void sim_setColor(uint8_t r, uint8_t g, uint8_t b) {
+    for (uint8_t head = 0; head < SIM_HEADS; ++head)
+        sim_setHeadColor(head, r, g, b);
+}
+
+void sim_setAmbient(uint16_t level) { sim_ambient = level; }
+
+void sim_setLed(uint8_t index, uint8_t pin, uint16_t gain, uint8_t head) {
+    if (index >= SIM_LEDS)
+        return;
+    sim_leds[index].pin = pin;
+    sim_leds[index].gain = gain;
+    sim_leds[index].head = head;
+}
+
+static void sim_accountLeds(uint32_t us) {
+    for (uint8_t i = 0; i < SIM_LEDS; ++i)
+        if (sim_leds[i].pin < NUM_DIGITAL_PINS)
+            sim_led_us += us * (pin_pwm[sim_leds[i].pin] / 255.0);
+}
+
+double sim_ledOnSeconds() { return sim_led_us / 1e6; }
+
+void sim_setTau(uint16_t ms) { sim_tau_ms = ms ? ms : 1; }
+
+void sim_setNoise(uint8_t lsb) { sim_noise = lsb; }
+
+static uint32_t sim_random() {
+    // xorshift32: одинаковая последовательность при каждом запуске
+    sim_random_state ^= sim_random_state << 13;
+    sim_random_state ^= sim_random_state >> 17;
+    sim_random_state ^= sim_random_state << 5;
+    return sim_random_state;
+}
+
+static double sim_targetLevel(uint8_t head) {
+    double light = sim_ambient;
+    for (uint8_t i = 0; i < SIM_LEDS; ++i) {
+        uint8_t pin = sim_leds[i].pin;
+        if (pin < NUM_DIGITAL_PINS &&
+            (sim_leds[i].head == SIM_ALL_HEADS || sim_leds[i].head == head))
+            light += sim_leds[i].gain * (pin_pwm[pin] / 255.0) *
+                     (sim_reflectance[head][i % SIM_LED_COLORS] / 255.0);
+    }
+    // Фоторезистор в нижнем плече делителя: R_ldr ~ E^-gamma, при
+    // освещённости SIM_LDR_MIDPOINT он равен постоянному резистору
+    if (light <= 0)
+        return 1023;
+    double ratio = pow(light / SIM_LDR_MIDPOINT, -SIM_LDR_GAMMA);
+    return 1023 * ratio / (1 + ratio);
+}
+
+// Датчики на A0-A3, остальные входы читаются как A0
+int analogRead(uint8_t pin) {
+    pins_init();
+    uint8_t head = pin >= A0 ? pin - A0 : pin;
+    if (head >= SIM_HEADS)
+        head = 0;
+    double dt_ms = (sim_now_us - sim_level_time[head]) / 1000.0;
+    sim_level_time[head] = sim_now_us;
+    double target = sim_targetLevel(head);
+    double &level = sim_level[head];
+    level += (target - level) * (1 - exp(-dt_ms / sim_tau_ms));
+    int noise = sim_noise ? (int)(sim_random() % (2 * sim_noise + 1)) - sim_noise
+                          : 0;
+    int value = (int)(level + 0.5) + noise;
+    return constrain(value, 0, 1023);
+}
+
+// ---- Serial ----
+
+static unsigned long serial_baud = 0;
+static uint64_t serial_drained_at = 0;
+static uint32_t serial_pending = 0;
+static boolean serial_echo = false;
+static uint32_t serial_bytes = 0;
+static uint32_t serial_readings = 0;
+
+static char serial_rx[SERIAL_RX_BUFFER_SIZE];
+static uint8_t serial_rx_head = 0, serial_rx_tail = 0;
+
+static char text_line[SERIAL_BATCH_BUFFER_SIZE];
+static uint8_t text_length = 0;
+static char last_line[SERIAL_BATCH_BUFFER_SIZE + 1];
+// Последние байты вывода: хватает на самый длинный кадр пакета
+const uint8_t FRAME_WINDOW_SIZE =
+    FRAME_BATCH_OVERHEAD + FRAME_BATCH_ENTRY_SIZE * SERIAL_BATCH_CAPACITY;
+static uint8_t frame_window[FRAME_WINDOW_SIZE];
+static uint8_t frame_filled = 0;
+
+void sim_setSerialEcho(boolean echo) { serial_echo = echo; }
+
+uint32_t sim_serialBytes() { return serial_bytes; }
+
+uint32_t sim_serialReadings() { return serial_readings; }
+
+const char *sim_serialLastLine() { return last_line; }
+
+void sim_serialInput(const char *text) {
+    for (; *text; ++text) {
+        uint8_t next = (serial_rx_head + 1) % SERIAL_RX_BUFFER_SIZE;
+        if (next == serial_rx_tail)
+            return;  // как и на плате, лишнее теряется
+        uint8_t byte = *text;
+        // \xHH - произвольный байт, для двоичных команд
+        if (text[0] == '\\' && text[1] == 'x' && isxdigit(text[2]) &&
+            isxdigit(text[3])) {
+            char hex[3] = {text[2], text[3], 0};
+            byte = strtoul(hex, NULL, 16);
+            text += 3;
+        }
+        serial_rx[serial_rx_head] = byte;
+        serial_rx_head = next;
+    }
+}
+
+// Сколько байт ещё не ушло из буфера передачи к текущему моменту
+static void serial_drain() {
+    if (!serial_baud) {
+        serial_pending = 0;
+        return;
+    }
+    uint64_t byte_us = 10000000ULL / serial_baud;
+    uint64_t sent = (sim_now_us - serial_drained_at) / byte_us;
+    if (sent >= serial_pending) {
+        serial_pending = 0;
+        serial_drained_at = sim_now_us;
+    } else {
+        serial_pending -= sent;
+        serial_drained_at += sent * byte_us;
+    }
+}
+
+// Заканчивается ли вывод кадром длины length, начало кадра в *frame
+static boolean frame_ends(uint8_t length, const uint8_t **frame) {
+    if (frame_filled < length)
+        return false;
+    const uint8_t *start = frame_window + frame_filled - length;
+    *frame = start;
+    return start[0] == FRAME_SYNC &&
+           crc8(start, length - 1) == start[length - 1];
+}
+
+// Считаем пакеты с цветом, чтобы симулятор мог сообщить темп измерений
+static void serial_count(uint8_t c) {
+    if (frame_filled == FRAME_WINDOW_SIZE) {
+        memmove(frame_window, frame_window + 1, FRAME_WINDOW_SIZE - 1);
+        frame_filled--;
+    }
+    frame_window[frame_filled++] = c;
+
+    const uint8_t *frame;
+    if (frame_ends(FRAME_SIZE, &frame)) {
+        uint8_t type = frame[2] >> 4;
+        // Кадры уровней и компонент идут по одному на цвет, считаем первый
+        // (у каждого датчика свой)
+        if (type == ColorFrame || type == RawLevelsFrame ||
+            (type == LevelFrame && (frame[3] & 0x0F) == 0) ||
+            (type == ComponentFrame && (frame[4] & 0x0F) == 0)) {
+            serial_readings++;
+            frame_filled = 0;
+        }
+    }
+    for (uint8_t n = 2; n <= SERIAL_BATCH_CAPACITY; ++n) {
+        if (frame_ends(FRAME_BATCH_OVERHEAD + FRAME_BATCH_ENTRY_SIZE * n,
+                       &frame) &&
+            frame[2] >> 4 == BatchFrame && frame[4] == n) {
+            serial_readings += n;
+            frame_filled = 0;
+            break;
+        }
+    }
+
+    if (c == '\n') {
+        // $#$R,G,B@!@ или с буквой пространства: $#$H..., $#$X..., $#$L...,
+        // в пакете измерения разделены ';'
+        if (text_length > 3 && !strncmp(text_line, "$#$", 3) &&
+            strchr("0123456789HXL", text_line[3])) {
+            serial_readings++;
+            for (uint8_t i = 3; i < text_length; ++i)
+                serial_readings += text_line[i] == ';';
+        }
+        if (text_length && text_line[text_length - 1] == '\r')
+            text_length--;
+        memcpy(last_line, text_line, text_length);
+        last_line[text_length] = 0;
+        text_length = 0;
+    } else if (text_length < sizeof(text_line)) {
+        text_line[text_length++] = c;
+    }
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+    serial_baud = baud;
+    serial_drained_at = sim_now_us;
+}
+
+void HardwareSerial::flush() {
+    serial_drain();
+    if (serial_baud && serial_pending)
+        sim_advance(serial_pending * 10000000ULL / serial_baud);
+    serial_drain();
+}
+
+int HardwareSerial::available() {
+    return (SERIAL_RX_BUFFER_SIZE + serial_rx_head - serial_rx_tail) %
+           SERIAL_RX_BUFFER_SIZE;
+}
+
+int HardwareSerial::read() {
+    if (serial_rx_head == serial_rx_tail)
+        return -1;
+    uint8_t c = serial_rx[serial_rx_tail];
+    serial_rx_tail = (serial_rx_tail + 1) % SERIAL_RX_BUFFER_SIZE;
+    return c;
+}
+
+int HardwareSerial::peek() {
+    return serial_rx_head == serial_rx_tail ? -1 : serial_rx[serial_rx_tail];
+}
+
+int HardwareSerial::availableForWrite() {
+    serial_drain();
+    return SERIAL_TX_BUFFER_SIZE - 1 - serial_pending;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    serial_drain();
+    // Буфер полон - ждём, пока уйдёт один байт, как HardwareSerial на плате
+    if (serial_baud && serial_pending >= SERIAL_TX_BUFFER_SIZE - 1) {
+        sim_advance(10000000ULL / serial_baud);
+        serial_drain();
+    }
+    serial_pending++;
+    serial_bytes++;
+    serial_count(c);
+    if (serial_echo)
+        putchar(c);
+    return 1;
+}
+
+// ---- Print ----
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--)
+        n += write(*buffer++);
+    return n;
+}
+
+size_t Print::print(const __FlashStringHelper *str) {
+    return write(reinterpret_cast<const char *>(str));
+}
+
+size_t Print::printNumber(unsigned long value, uint8_t base) {
+    char buffer[8 * sizeof(long) + 1];
+    char *p = &buffer[sizeof(buffer) - 1];
+    *p = 0;
+    if (base < 2)
+        base = 10;
+    do {
+        uint8_t digit = value % base;
+        value /= base;
+        *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    } while (value);
+    return write(p);
+}
+
+size_t Print::print(unsigned char value, int base) {
+    return printNumber(value, base);
+}
+
+size_t Print::print(int value, int base) { return print((long)value, base); }
+
+size_t Print::print(unsigned int value, int base) {
+    return printNumber(value, base);
+}
+
+size_t Print::print(long value, int base) {
+    if (base == 10 && value < 0)
+        return print('-') + printNumber(-(unsigned long)value, 10);
+    return printNumber(value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    return printNumber(value, base);
+}
+
+size_t Print::print(double value, int digits) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return write(buffer);
+}
+
+// ---- EEPROM ----
+
+static uint8_t eeprom_data[E2END + 1];
+static boolean eeprom_ready = false;
+
+uint8_t EEPROMClass::read(int address) {
+    if (!eeprom_ready) {
+        memset(eeprom_data, 0xFF, sizeof(eeprom_data));
+        eeprom_ready = true;
+    }
+    return address >= 0 && address <= E2END ? eeprom_data[address] : 0xFF;
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+    read(0);
+    if (address < 0 || address > E2END)
+        return;
+    eeprom_data[address] = value;
+    writes++;
+    // Запись ячейки EEPROM занимает 3.3 мс
+    sim_advance(3300);
+}
+
+void EEPROMClass::update(int address, uint8_t value) {
+    if (read(address) != value)
+        write(address, value);
+}
@@ -0,0 +1,115 @@
+#include <LCD_1602_RUS.h>
+
+// Адреса начала строк в DDRAM HD44780
+static const uint8_t ROW_OFFSETS[] = {0x00, 0x40};
+
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t /* address */, uint8_t cols,
+                                     uint8_t rows)
+    : _cols(cols), _rows(rows) {
+    memset(_ddram, ' ', sizeof(_ddram));
+}
+
+void LiquidCrystal_I2C::init() { clear(); }
+
+void LiquidCrystal_I2C::begin() { clear(); }
+
+void LiquidCrystal_I2C::clear() {
+    memset(_ddram, ' ', sizeof(_ddram));
+    _address_counter = 0;
+    commandBytes++;
+}
+
+void LiquidCrystal_I2C::home() {
+    _address_counter = 0;
+    commandBytes++;
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+    command(0x80 | (ROW_OFFSETS[row & 1] + col));
+}
+
+void LiquidCrystal_I2C::backlight() {}
+
+void LiquidCrystal_I2C::noBacklight() {}
+
+void LiquidCrystal_I2C::createChar(uint8_t /* location */,
+                                   const uint8_t /* charmap */[]) {
+    commandBytes++;
+    dataBytes += 8;
+}
+
+void LiquidCrystal_I2C::command(uint8_t value) {
+    commandBytes++;
+    if (value & 0x80)
+        _address_counter = value & 0x7F;
+    else if (value == 0x01 || value == 0x02)
+        _address_counter = 0;
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t value) {
+    dataBytes++;
+    uint8_t row = _address_counter >= 0x40 ? 1 : 0;
+    uint8_t col = _address_counter - ROW_OFFSETS[row];
+    if (col < 40)
+        _ddram[row][col] = value < 8 ? '?' : (char)value;
+    _address_counter++;
+    return 1;
+}
+
+const char *LiquidCrystal_I2C::row(uint8_t index) {
+    index &= 1;
+    memcpy(_visible[index], _ddram[index], 16);
+    _visible[index][16] = 0;
+    return _visible[index];
+}
+
+LCD_1602_RUS::LCD_1602_RUS(uint8_t address, uint8_t cols, uint8_t rows)
+    : LiquidCrystal_I2C(address, cols, rows) {}
+
+void LCD_1602_RUS::clear() {
+    LiquidCrystal_I2C::clear();
+    clears++;
+    _glyph_count = 0;
+    _col = _row = 0;
+}
+
+void LCD_1602_RUS::setCursor(uint8_t col, uint8_t row) {
+    LiquidCrystal_I2C::setCursor(col, row);
+    _col = col;
+    _row = row;
+}
+
+uint8_t LCD_1602_RUS::getCursorCol() { return _col; }
+
+uint8_t LCD_1602_RUS::getCursorRow() { return _row; }
+
+// Буквы, которые LCD_1602_RUS выводит готовыми латинскими символами
+static const wchar_t LOOKALIKES_RUS[] = L"АВЕКМНОРСТХаеорсух";
+static const char LOOKALIKES_LAT[] = "ABEKMHOPCTXaeopcyx";
+
+void LCD_1602_RUS::print(const wchar_t *str) {
+    for (; *str; ++str, ++_col) {
+        wchar_t c = *str;
+        for (uint8_t i = 0; LOOKALIKES_RUS[i]; ++i)
+            if (c == LOOKALIKES_RUS[i])
+                c = LOOKALIKES_LAT[i];
+        if (c < 0x80) {
+            write((uint8_t)c);
+            continue;
+        }
+        uint8_t slot = 0;
+        while (slot < _glyph_count && _glyphs[slot] != c)
+            slot++;
+        if (slot == _glyph_count) {
+            if (_glyph_count < 8) {
+                _glyphs[_glyph_count++] = c;
+                createChar(slot, nullptr);
+                setCursor(_col, _row);
+            } else {
+                glyphOverflows++;
+                slot = 7;
+            }
+        }
+        write(slot);
+    }
+}
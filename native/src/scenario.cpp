@@ -0,0 +1,69 @@
+#include <stdio.h>
+
+#include "sim.h"
+
+// Одно событие сценария
+struct SimEvent {
+    uint64_t time_us;
+    char line[64];
+};
+
+static const uint16_t SIM_MAX_EVENTS = 256;
+
+static SimEvent sim_events[SIM_MAX_EVENTS];
+static uint16_t sim_event_count = 0, sim_event_next = 0;
+
+boolean sim_loadScenario(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return false;
+    char line[96];
+    while (fgets(line, sizeof(line), file) &&
+           sim_event_count < SIM_MAX_EVENTS) {
+        double seconds;
+        int offset = 0;
+        if (line[0] == '#' || sscanf(line, "%lf %n", &seconds, &offset) != 1)
+            continue;
+        SimEvent &event = sim_events[sim_event_count++];
+        event.time_us = (uint64_t)(seconds * 1e6);
+        strncpy(event.line, line + offset, sizeof(event.line) - 1);
+        event.line[sizeof(event.line) - 1] = 0;
+    }
+    fclose(file);
+    return true;
+}
+
+static void sim_apply(const char *line) {
+    char command[16];
+    int offset = 0;
+    if (sscanf(line, "%15s %n", command, &offset) != 1)
+        return;
+    const char *args = line + offset;
+    int a = 0, b = 0, c = 0, d = -1;
+    if (!strcmp(command, "color") && sscanf(args, "%d %d %d", &a, &b, &c) == 3)
+        sim_setColor(a, b, c);
+    else if (!strcmp(command, "head") &&
+             sscanf(args, "%d %d %d %d", &a, &b, &c, &d) == 4)
+        sim_setHeadColor(a, b, c, d);
+    else if (!strcmp(command, "ambient") && sscanf(args, "%d", &a) == 1)
+        sim_setAmbient(a);
+    else if (!strcmp(command, "led") &&
+             sscanf(args, "%d %d %d %d", &a, &b, &c, &d) >= 3)
+        sim_setLed(a, b, c, d >= 0 && d < SIM_HEADS ? d : SIM_ALL_HEADS);
+    else if (!strcmp(command, "tau") && sscanf(args, "%d", &a) == 1)
+        sim_setTau(a);
+    else if (!strcmp(command, "noise") && sscanf(args, "%d", &a) == 1)
+        sim_setNoise(a);
+    else if (!strcmp(command, "pin") && sscanf(args, "%d %d", &a, &b) == 2)
+        sim_setPin(a, b);
+    else if (!strcmp(command, "serial"))
+        sim_serialInput(args);
+    else
+        fprintf(stderr, "scenario: unknown command '%s'\n", command);
+}
+
+void sim_runScenario() {
+    while (sim_event_next < sim_event_count &&
+           sim_events[sim_event_next].time_us <= sim_time())
+        sim_apply(sim_events[sim_event_next++].line);
+}
@@ -0,0 +1,102 @@
+#include <LCD_1602_RUS.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "sim.h"
+
+/*
+    Точка входа симулятора: setup(), затем loop() до конца виртуального
+    времени. Каждый проход loop() сдвигает часы на --loop-us (стоимость
+    прохода на плате), остальное время добавляют delay() и Serial.
+
+    Параметры:
+      --seconds <n>     сколько секунд виртуального времени (60)
+      --loop-us <n>     виртуальная длительность прохода loop(), мкс (100)
+      --scenario <file> сценарий модели, см. sim.h
+      --echo            выводить то, что устройство пишет в Serial
+      --lcd             показать содержимое экрана в конце
+      --uptime <s>      сколько секунд плата уже работает к началу: 4294957
+                        даёт переполнение millis() на 10-й секунде
+*/
+
+// Тесты (pio test -e native) собираются вместе с src/ и native/src/, но
+// со своим main()
+#ifndef PIO_UNIT_TESTING
+
+void setup();
+void loop();
+
+extern LCD_1602_RUS lcd;
+
+int main(int argc, char **argv) {
+    double seconds = 60;
+    uint32_t loop_us = 100;
+    boolean show_lcd = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--loop-us") && i + 1 < argc) {
+            loop_us = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--scenario") && i + 1 < argc) {
+            if (!sim_loadScenario(argv[++i])) {
+                fprintf(stderr, "Cannot open scenario %s\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--echo")) {
+            sim_setSerialEcho(true);
+        } else if (!strcmp(argv[i], "--lcd")) {
+            show_lcd = true;
+        } else if (!strcmp(argv[i], "--uptime") && i + 1 < argc) {
+            sim_setUptime((uint64_t)(atof(argv[++i]) * 1e6));
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [--seconds n] [--loop-us n] [--scenario file] "
+                    "[--echo] [--lcd] [--uptime s]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (!loop_us)
+        loop_us = 1;
+
+    uint64_t end_us = (uint64_t)(seconds * 1e6);
+    uint64_t loops = 0;
+    clock_t cpu_started = clock();
+
+    sim_runScenario();
+    setup();
+    while (sim_time() < end_us) {
+        sim_runScenario();
+        loop();
+        sim_advance(loop_us);
+        loops++;
+    }
+
+    double cpu_seconds = (double)(clock() - cpu_started) / CLOCKS_PER_SEC;
+    double sim_seconds = sim_time() / 1e6;
+    uint32_t readings = sim_serialReadings();
+
+    fflush(stdout);
+    fprintf(stderr, "simulated:        %.1f s (%llu loop passes)\n",
+            sim_seconds, (unsigned long long)loops);
+    fprintf(stderr, "host CPU:         %.3f s (x%.0f real time)\n",
+            cpu_seconds, cpu_seconds > 0 ? sim_seconds / cpu_seconds : 0);
+    fprintf(stderr, "readings:         %lu\n", (unsigned long)readings);
+    fprintf(stderr, "readings/sim s:   %.3f\n",
+            sim_seconds > 0 ? readings / sim_seconds : 0);
+    fprintf(stderr, "readings/CPU s:   %.0f\n",
+            cpu_seconds > 0 ? readings / cpu_seconds : 0);
+    fprintf(stderr, "serial bytes:     %lu\n", (unsigned long)sim_serialBytes());
+    fprintf(stderr, "led on:           %.1f s\n", sim_ledOnSeconds());
+    fprintf(stderr, "lcd bytes:        %lu data, %lu commands\n",
+            (unsigned long)lcd.dataBytes, (unsigned long)lcd.commandBytes);
+    if (lcd.glyphOverflows)
+        fprintf(stderr, "lcd CGRAM overflows: %lu\n",
+                (unsigned long)lcd.glyphOverflows);
+    if (show_lcd)
+        fprintf(stderr, "+----------------+\n|%s|\n|%s|\n+----------------+\n",
+                lcd.row(0), lcd.row(1));
+    return 0;
+}
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef ACQUISITION_HPP
+#define ACQUISITION_HPP
+
+#include <Arduino.h>
+
+#include "adc_sampler.hpp"
+#include "led_pwm.hpp"
+#include "settle_detector.hpp"
+
+/*
+    Последовательность измерения по таблице фаз.
+    - Одна фаза - один светодиод: включить, дождаться установления
+      сигнала (SettleDetector), набрать нужное количество выборок АЦП,
+      выключить
+    - Таблица фаз хранится во flash, количество фаз - параметр шаблона,
+      так что добавление светодиода (белый, ИК) - это одна строка таблицы,
+      а не ещё два состояния в switch
+    - Выборки фазы суммируются пакетом в прерывании АЦП (adc_startBurst).
+      Уровень - среднее с передискретизацией: сумма масштабируется к
+      заданной разрядности (10-16 бит). Каждое учетверение количества
+      выборок даёт один лишний бит, если шум не меньше 1 единицы АЦП
+    - Под одним светодиодом могут стоять несколько фоторезисторов
+      (параметр S): АЦП опрашивает их по кругу, установление сигнала
+      ждётся один раз на фазу, уровни - отдельные для каждого датчика
+    - Светодиод фазы горит со скважностью duty() (см. led_pwm.hpp),
+      по умолчанию в полную силу
+    - Досрочная остановка (setEarlyStop): пакет заканчивается, как только
+      доверительный интервал среднего у всех датчиков становится уже
+      допуска.
+      Количество выборок из таблицы (или передискретизации) - верхний
+      предел, фактическое - samplesUsed()
+    - start(first, count) проходит только часть фаз (например, одну для
+      пробного измерения), уровни остальных фаз не меняются
+*/
+
+// Наибольшая разрядность уровня
+const uint8_t ACQUISITION_MAX_BITS = 16;
+// Через сколько выборок проверять, не пора ли остановить пакет досрочно
+const uint8_t ACQUISITION_CHECK_SAMPLES = 16;
+
+// Описание одной фазы измерения
+struct AcquisitionPhase {
+    uint8_t led_pin;          // пин светодиода
+    uint8_t settle_timeout;   // наибольшее время установления сигнала, мс
+    uint16_t samples;         // количество выборок АЦП
+    uint8_t slot;             // ячейка калибровки, куда идёт результат
+};
+
+template <uint8_t N, uint8_t S = 1>
+class AcquisitionSequencer {
+  public:
+    // phases - таблица в PROGMEM
+    AcquisitionSequencer(const AcquisitionPhase (&phases)[N],
+                         SettleDetector &settle)
+        : _phases(phases), _settle(settle) {
+        memset(_duty, 255, sizeof(_duty));
+    }
+
+    // Настроить пины светодиодов
+    void begin() {
+        for (uint8_t i = 0; i < N; ++i)
+            led_begin(ledPin(i));
+    }
+
+    // Включить или выключить все светодиоды
+    void switchLeds(bool state) {
+        for (uint8_t i = 0; i < N; ++i)
+            led_write(ledPin(i), state ? 255 : 0);
+    }
+
+    // Начать измерение: count фаз, начиная с first
+    void start(uint8_t first = 0, uint8_t count = N) {
+        _phase = first;
+        _end = min(first + count, (int)N);
+        enterWaiting();
+    }
+
+    // Прервать измерение: светодиоды и АЦП выключаются
+    void cancel() {
+        switchLeds(LOW);
+        adc_stop();
+        _step = Idle;
+    }
+
+    // Количество выборок на уровень (0 - брать из таблицы фаз) и
+    // разрядность уровней. Действует со следующего измерения
+    void setOversampling(uint16_t ratio, uint8_t bits) {
+        _ratio = ratio;
+        _bits = constrain(bits, ADC_RESOLUTION_BITS, ACQUISITION_MAX_BITS);
+    }
+    uint16_t oversampling() { return _ratio; }
+    uint8_t resolution() { return _bits; }
+
+    // Допуск доверительного интервала среднего (1/16 ед. АЦП, 0 - всегда
+    // набирать все выборки) и наименьшее количество выборок
+    void setEarlyStop(uint8_t tolerance_x16, uint16_t min_samples) {
+        _tolerance = min(tolerance_x16, ADC_MAX_TOLERANCE_X16);
+        _min_samples = max(min_samples, (uint16_t)2);
+    }
+    uint8_t earlyStopTolerance() { return _tolerance; }
+    uint16_t earlyStopMinSamples() { return _min_samples; }
+
+    boolean isRunning() { return _step != Idle; }
+    boolean isWaiting() { return _step == Waiting; }
+
+    // Продвинуть измерение, вызывать из loop(). Возвращает true, когда
+    // пройдены все фазы и готовы уровни level()
+    boolean tick() {
+        switch (_step) {
+            case Waiting:
+                adc_sleepConversions(ADC_SLEEP_BLOCK);
+                if (!_settle.isSettled())
+                    return false;
+                _settle_times[_phase] = _settle.settleTime();
+                adc_startBurst(_ratio ? _ratio : samples(_phase), _tolerance);
+                _next_check = _min_samples;
+                _step = Reading;
+                return false;
+            case Reading:
+                adc_sleepConversions(ADC_SLEEP_BLOCK);
+                if (!adc_burstReady() && !confident())
+                    return false;
+                adc_stopBurst();
+                for (uint8_t sensor = 0; sensor < S; ++sensor)
+                    _levels[sensor][_phase] = decimate(
+                        adc_burstSum(sensor), adc_burstCount(sensor));
+                _used[_phase] = adc_burstCount();
+                led_write(ledPin(_phase), 0);
+                if (++_phase < _end) {
+                    enterWaiting();
+                    return false;
+                }
+                adc_stop();
+                _step = Idle;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static constexpr uint8_t channels() { return N; }
+    static uint8_t sensors() { return S; }
+    // Светодиоды общие для всех датчиков: скважность одна на фазу
+    static bool sharedLeds() { return true; }
+
+    uint8_t ledPin(uint8_t phase) {
+        return pgm_read_byte(&_phases[phase].led_pin);
+    }
+    uint8_t settleTimeout(uint8_t phase) {
+        return pgm_read_byte(&_phases[phase].settle_timeout);
+    }
+    uint16_t samples(uint8_t phase) {
+        return pgm_read_word(&_phases[phase].samples);
+    }
+    uint8_t slot(uint8_t phase) { return pgm_read_byte(&_phases[phase].slot); }
+
+    // Скважность светодиода фазы (1-255), светодиоды общие для всех
+    // датчиков. Действует со следующего включения светодиода
+    void setDuty(uint8_t phase, uint8_t duty, uint8_t /* sensor */ = 0) {
+        _duty[phase] = duty ? duty : 1;
+    }
+    uint8_t duty(uint8_t phase, uint8_t /* sensor */ = 0) {
+        return _duty[phase];
+    }
+
+    // Уровень фазы датчика при последнем измерении в разрядности resolution()
+    uint16_t level(uint8_t phase, uint8_t sensor = 0) {
+        return _levels[sensor][phase];
+    }
+    // Время установления сигнала фазы при последнем измерении, мс
+    uint16_t settleTime(uint8_t phase) { return _settle_times[phase]; }
+    // Сколько выборок набрано в фазе при последнем измерении
+    uint16_t samplesUsed(uint8_t phase, uint8_t /* sensor */ = 0) {
+        return _used[phase];
+    }
+
+  private:
+    enum Step : uint8_t { Idle = 0, Waiting, Reading };
+
+    // Среднее с округлением, масштабированное к _bits разрядам.
+    // Сумма не больше 1023 * 65535, после сдвига на 6 бит всё ещё
+    // помещается в 32 бита
+    uint16_t decimate(uint32_t sum, uint16_t count) {
+        if (!count)
+            return 0;
+        sum <<= _bits - ADC_RESOLUTION_BITS;
+        return (sum + count / 2) / count;
+    }
+
+    // Среднее всех датчиков уже достаточно точное. Разброс считается
+    // не на каждом проходе loop(), а через ACQUISITION_CHECK_SAMPLES
+    boolean confident() {
+        if (!_tolerance || adc_burstCount() < _next_check)
+            return false;
+        _next_check = adc_burstCount() + ACQUISITION_CHECK_SAMPLES;
+        for (uint8_t sensor = 0; sensor < S; ++sensor)
+            if (!adc_burstConfident(sensor, _tolerance, _min_samples))
+                return false;
+        return true;
+    }
+
+    void enterWaiting() {
+        led_write(ledPin(_phase), _duty[_phase]);
+        _settle.setTimeout(settleTimeout(_phase));
+        _settle.start();
+        _step = Waiting;
+    }
+
+    const AcquisitionPhase *_phases;
+    SettleDetector &_settle;
+    Step _step = Idle;
+    uint8_t _phase = 0, _end = N;
+    uint16_t _ratio = 0;
+    uint8_t _bits = ADC_RESOLUTION_BITS;
+    uint8_t _tolerance = 0;
+    uint16_t _min_samples = 2, _next_check = 0;
+    uint16_t _used[N] = {};
+    uint8_t _duty[N];
+    uint16_t _levels[S][N] = {};
+    uint16_t _settle_times[N] = {};
+};
+
+#endif
@@ -0,0 +1,374 @@
+#include "adc_sampler.hpp"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#endif
+
+static const uint8_t ADC_BUFFER_MASK = ADC_BUFFER_SIZE - 1;
+
+static volatile uint16_t adc_buffer[ADC_BUFFER_SIZE];
+static volatile uint8_t adc_head = 0;  // пишет только прерывание
+static volatile uint8_t adc_tail = 0;  // пишет только основной цикл
+static volatile uint16_t adc_lost = 0;
+
+// Пакетный режим: пока осталось что набирать, выборки идут в суммы входов
+static volatile uint32_t adc_burst_left = 0;
+static volatile uint32_t adc_burst_sums[ADC_MAX_CHANNELS];
+static volatile uint16_t adc_burst_counts[ADC_MAX_CHANNELS];
+// Разброс: первая выборка входа и сумма квадратов отклонений от неё
+static bool adc_burst_variance = false;
+static volatile uint16_t adc_burst_refs[ADC_MAX_CHANNELS];
+static volatile uint32_t adc_burst_squares[ADC_MAX_CHANNELS];
+
+static uint8_t adc_pins[ADC_MAX_CHANNELS] = {A0};
+static uint8_t adc_channel_count = 1;
+// Вход, к которому относится следующая выборка
+static volatile uint8_t adc_sample_channel = 0;
+static bool adc_running = false;
+static bool adc_noise_reduction = false;
+static uint8_t adc_prescaler_log2 = ADC_PRESCALER_MAX_LOG2;
+
+static inline void adc_burstComplete();
+
+// Забыть пакет: счётчик и суммы входов. Вызывать при запрещённых
+// прерываниях или остановленном АЦП
+static inline void adc_burstClear() {
+    adc_burst_left = 0;
+    memset((void *)adc_burst_sums, 0, sizeof(adc_burst_sums));
+    memset((void *)adc_burst_counts, 0, sizeof(adc_burst_counts));
+    memset((void *)adc_burst_squares, 0, sizeof(adc_burst_squares));
+}
+
+static inline uint8_t adc_nextChannel(uint8_t channel) {
+    return ++channel < adc_channel_count ? channel : 0;
+}
+
+static inline void adc_burstSquare(uint16_t sample, uint8_t channel) {
+    if (!adc_burst_counts[channel]++)
+        adc_burst_refs[channel] = sample;
+    int16_t deviation = sample - adc_burst_refs[channel];
+    uint16_t magnitude = deviation < 0 ? -deviation : deviation;
+    uint32_t squares =
+        adc_burst_squares[channel] + (uint32_t)magnitude * magnitude;
+    adc_burst_squares[channel] =
+        squares < adc_burst_squares[channel] ? UINT32_MAX : squares;
+}
+
+// Сторона производителя, вызывается из прерывания (или заглушки)
+static inline void adc_push(uint16_t sample, uint8_t channel) {
+    if (adc_burst_left) {
+        adc_burst_sums[channel] += sample;
+        if (adc_burst_variance)
+            adc_burstSquare(sample, channel);
+        else
+            adc_burst_counts[channel]++;
+        if (!--adc_burst_left)
+            adc_burstComplete();
+        return;
+    }
+    uint8_t next = (adc_head + 1) & ADC_BUFFER_MASK;
+    if (next == adc_tail) {
+        adc_lost++;
+        return;
+    }
+    adc_buffer[adc_head] = sample;
+    adc_head = next;
+}
+
+#ifdef __AVR__
+
+static volatile bool adc_conversion_done;
+
+static inline uint8_t adc_mux(uint8_t pin) {
+    return _BV(REFS0) | ((pin >= A0 ? pin - A0 : pin) & 0x07);
+}
+
+ISR(ADC_vect) {
+    uint8_t channel = adc_sample_channel;
+    adc_sample_channel = adc_nextChannel(channel);
+    // В свободном режиме уже идёт преобразование следующего входа, ADMUX
+    // подействует на то, что после него. Во сне преобразования одиночные
+    if (adc_channel_count > 1)
+        ADMUX = adc_mux(adc_pins[adc_noise_reduction
+                                     ? adc_sample_channel
+                                     : adc_nextChannel(adc_sample_channel)]);
+    adc_push(ADC, channel);
+    adc_conversion_done = true;
+}
+
+// Биты ADPS2..0 совпадают с log2 делителя (кроме делителя 2)
+static inline uint8_t adc_prescalerBits() { return adc_prescaler_log2; }
+
+// Пакет набран: останавливаем свободный запуск, чтобы лишние выборки
+// не переполняли буфер, пока loop() не заберёт результат
+static inline void adc_burstComplete() { ADCSRA &= ~_BV(ADATE); }
+
+void adc_begin(const uint8_t *pins, uint8_t count) {
+    adc_channel_count = constrain(count, 1, ADC_MAX_CHANNELS);
+    for (uint8_t i = 0; i < adc_channel_count; ++i) {
+        adc_pins[i] = pins[i];
+        uint8_t channel = pins[i] >= A0 ? pins[i] - A0 : pins[i];
+        if (channel < 6)
+            DIDR0 |= _BV(channel);
+    }
+    ADMUX = adc_mux(adc_pins[0]);
+}
+
+void adc_start() {
+    // Дожидаемся преобразования, оставшегося от прошлого пакета: его
+    // выборка иначе попала бы не на тот вход
+    while (ADCSRA & _BV(ADSC))
+        ;
+    adc_flush();
+    adc_running = true;
+    adc_sample_channel = 0;
+    ADMUX = adc_mux(adc_pins[0]);
+    ADCSRB = 0;
+    if (adc_noise_reduction) {
+        // Преобразование запускается входом в сон, см. adc_sleepConversions()
+        ADCSRA = _BV(ADEN) | _BV(ADIE) | adc_prescalerBits();
+    } else {
+        ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | adc_prescalerBits();
+        ADCSRA |= _BV(ADSC);
+        // Вход первого преобразования защёлкивается по фронту такта АЦП
+        // после ADSC: ADMUX можно менять не раньше, чем через такт АЦП
+        // (один период делителя, до 8 мкс). Тогда второе преобразование
+        // будет по следующему входу
+        if (adc_channel_count > 1) {
+            delayMicroseconds((1u << adc_prescaler_log2) / 16 + 1);
+            ADMUX = adc_mux(adc_pins[adc_nextChannel(0)]);
+        }
+    }
+}
+
+void adc_stop() {
+    adc_running = false;
+    // АЦП остаётся включённым, чтобы analogRead() продолжал работать
+    // Для analogRead() возвращаем делитель 128, как настраивает ядро
+    ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+    // Прерывание АЦП запрещено, недобранный пакет больше не нужен
+    adc_burstClear();
+}
+
+void adc_sleepConversions(uint8_t count) {
+    if (!adc_running || !adc_noise_reduction)
+        return;
+    set_sleep_mode(SLEEP_MODE_ADC);
+    while (count--) {
+        adc_conversion_done = false;
+        // Другие прерывания (Serial, Timer0) могут разбудить раньше времени,
+        // тогда просто засыпаем снова, преобразование продолжается
+        while (!adc_conversion_done) {
+            sleep_enable();
+            sleep_cpu();
+            sleep_disable();
+        }
+    }
+}
+
+#else
+
+static uint32_t adc_stub_last_us;
+
+static inline void adc_burstComplete() {}
+
+static void adc_stubSample() {
+    uint8_t channel = adc_sample_channel;
+    adc_sample_channel = adc_nextChannel(channel);
+    adc_push(analogRead(adc_pins[channel]), channel);
+}
+
+// Заглушка свободного запуска: одна выборка analogRead() на каждые
+// adc_conversionUs() прошедшего времени
+static void adc_stubRun() {
+    if (!adc_running || adc_noise_reduction)
+        return;
+    uint32_t now = micros();
+    uint16_t period = adc_conversionUs();
+    // В пакетном режиме буфер не заполняется, поэтому ограничиваем
+    // только длиной пакета, после него АЦП стоит (как adc_burstComplete())
+    bool burst = adc_burst_left;
+    uint8_t produced = 0;
+    while (now - adc_stub_last_us >= period &&
+           (burst ? adc_burst_left != 0 : produced < ADC_BUFFER_SIZE)) {
+        adc_stub_last_us += period;
+        adc_stubSample();
+        produced++;
+    }
+    // Если цикл надолго задержался, лишние выборки просто теряются
+    if (now - adc_stub_last_us >= period)
+        adc_stub_last_us = now;
+}
+
+void adc_stubPush(uint16_t sample) { adc_push(sample, 0); }
+
+void adc_begin(const uint8_t *pins, uint8_t count) {
+    adc_channel_count = constrain(count, 1, ADC_MAX_CHANNELS);
+    for (uint8_t i = 0; i < adc_channel_count; ++i)
+        adc_pins[i] = pins[i];
+}
+
+void adc_start() {
+    adc_flush();
+    adc_running = true;
+    adc_sample_channel = 0;
+    adc_stub_last_us = micros();
+}
+
+void adc_stop() {
+    adc_running = false;
+    adc_burstClear();
+}
+
+void adc_sleepConversions(uint8_t count) {
+    if (!adc_running || !adc_noise_reduction)
+        return;
+    while (count--)
+        adc_stubSample();
+}
+
+#endif
+
+void adc_begin(uint8_t pin) { adc_begin(&pin, 1); }
+
+uint8_t adc_channels() { return adc_channel_count; }
+
+void adc_startBurst(uint16_t count, bool variance) {
+    noInterrupts();
+    adc_burstClear();
+    adc_burst_variance = variance;
+    adc_burst_left = (uint32_t)count * adc_channel_count;
+    interrupts();
+    if (!adc_running)
+        adc_start();
+}
+
+void adc_stopBurst() {
+    noInterrupts();
+    if (adc_burst_left) {
+        adc_burst_left = 0;
+        adc_burstComplete();
+    }
+    interrupts();
+}
+
+bool adc_burstReady() {
+#ifndef __AVR__
+    adc_stubRun();
+#endif
+    noInterrupts();
+    bool ready = adc_burst_left == 0;
+    interrupts();
+    return ready;
+}
+
+uint32_t adc_burstSum(uint8_t channel) {
+    noInterrupts();
+    uint32_t sum = adc_burst_sums[channel];
+    interrupts();
+    return sum;
+}
+
+uint16_t adc_burstCount(uint8_t channel) {
+    noInterrupts();
+    uint16_t count = adc_burst_counts[channel];
+    interrupts();
+    return count;
+}
+
+// sum((d - среднее)^2) = sum(d^2) - sum(d)^2 / n = (n - 1) * s^2, где d -
+// отклонения от первой выборки. Условие 2 * s / sqrt(n) <= tolerance / 16
+// без корня: 1024 * (n - 1) * s^2 <= tolerance^2 * n * (n - 1). Всё в 32
+// битах: sum(d)^2 / n раскладывается по частям |sum(d)| = mean * n + rest
+// (mean < 1024, каждая часть не больше sum(d^2)), а дробные остатки обеих
+// сторон сводятся в один порог
+bool adc_burstConfident(uint8_t channel, uint8_t tolerance_x16,
+                        uint16_t min_count) {
+    noInterrupts();
+    uint16_t count = adc_burst_counts[channel];
+    uint32_t sum = adc_burst_sums[channel];
+    uint32_t squares = adc_burst_squares[channel];
+    uint16_t reference = adc_burst_refs[channel];
+    interrupts();
+    if (count < 2 || count < min_count || squares == UINT32_MAX)
+        return false;
+    int32_t deviation = (int32_t)(sum - (uint32_t)count * reference);
+    uint32_t magnitude = deviation < 0 ? -deviation : deviation;
+    uint32_t mean = magnitude / count, rest = magnitude % count;
+    // Иначе суммы несогласованы (пакет без variance)
+    if (mean * mean > squares / count)
+        return false;
+    uint32_t spread = squares - mean * mean * count;
+    if (2 * mean * rest > spread)
+        return false;
+    spread -= 2 * mean * rest;
+    // Осталось spread - rest^2 / n <= tolerance^2 * n * (n - 1) / 1024,
+    // то есть spread <= floor(tolerance^2 * pairs / 1024 + rest^2 / n)
+    uint8_t tolerance = min(tolerance_x16, ADC_MAX_TOLERANCE_X16);
+    uint16_t square = tolerance * tolerance;
+    uint32_t pairs = (uint32_t)count * (count - 1);
+    uint32_t scaled = square * (pairs & 1023);
+    uint32_t remainder = rest * rest;
+    uint32_t fraction = (scaled >> 10) + remainder / count +
+                        ((scaled & 1023) * count + remainder % count * 1024 >=
+                         1024ul * count);
+    if (square && (pairs >> 10) > (UINT32_MAX - fraction) / square)
+        return true;
+    return spread <= square * (pairs >> 10) + fraction;
+}
+
+void adc_setPrescaler(uint8_t log2_divider) {
+    adc_prescaler_log2 = constrain(log2_divider, ADC_PRESCALER_MIN_LOG2,
+                                   ADC_PRESCALER_MAX_LOG2);
+    if (adc_running)
+        adc_start();
+}
+
+uint8_t adc_prescaler() { return adc_prescaler_log2; }
+
+// 13 тактов АЦП на преобразование, тактовая частота 16 МГц
+uint16_t adc_conversionUs() { return (13u << adc_prescaler_log2) / 16; }
+
+void adc_setNoiseReduction(bool enable) {
+    adc_noise_reduction = enable;
+    if (adc_running)
+        adc_start();
+}
+
+void adc_flush() { adc_tail = adc_head; }
+
+uint8_t adc_available() {
+#ifndef __AVR__
+    adc_stubRun();
+#endif
+    return (adc_head - adc_tail) & ADC_BUFFER_MASK;
+}
+
+uint16_t adc_read() {
+    if (!adc_available())
+        return 0;
+    uint16_t sample = adc_buffer[adc_tail];
+    adc_tail = (adc_tail + 1) & ADC_BUFFER_MASK;
+    return sample;
+}
+
+uint16_t adc_readBlock(uint32_t &sum, uint16_t max_count) {
+    uint8_t count = adc_available();
+    if (count > max_count)
+        count = max_count;
+    uint8_t tail = adc_tail;
+    for (uint8_t i = 0; i < count; ++i) {
+        sum += adc_buffer[tail];
+        tail = (tail + 1) & ADC_BUFFER_MASK;
+    }
+    adc_tail = tail;
+    return count;
+}
+
+uint16_t adc_overruns() {
+    noInterrupts();
+    uint16_t lost = adc_lost;
+    interrupts();
+    return lost;
+}
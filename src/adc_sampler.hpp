@@ -0,0 +1,89 @@
+#ifndef ADC_SAMPLER_HPP
+#define ADC_SAMPLER_HPP
+
+#include <Arduino.h>
+
+/*
+    Сбор выборок АЦП по прерыванию.
+    - АЦП работает в режиме свободного запуска (free running), каждое
+      прерывание ADC_vect кладёт результат в кольцевой буфер
+    - Буфер без блокировок: голову двигает только прерывание, хвост - только
+      основной цикл, индексы однобайтовые и читаются атомарно
+    - Пакетный режим (adc_startBurst): прерывание само суммирует заданное
+      количество выборок, буфер не используется. Так передискретизация
+      успевает за АЦП даже на частоте 77 кГц (делитель 16)
+    - По запросу в пакете считается ещё и сумма квадратов отклонений от
+      первой выборки: по ней основной цикл видит разброс и может
+      остановить пакет досрочно (adc_burstConfident, adc_stopBurst).
+      Отклонения от первой выборки малы, поэтому квадраты помещаются в
+      32 бита, а при большом разбросе сумма просто насыщается
+    - Несколько входов (датчиков) опрашиваются по кругу, начиная с первого:
+      в буфер выборки идут вперемешку, в пакетном режиме у каждого входа
+      своя сумма. В свободном режиме следующее преобразование уже запущено,
+      поэтому прерывание переключает ADMUX на вход через одно
+    - Опционально - режим подавления шума (SLEEP_MODE_ADC): процессор спит
+      во время каждого преобразования. В этом режиме останавливается Timer0,
+      поэтому millis() отстаёт примерно на 100 мкс на каждую выборку
+    - Без AVR (сборка на ПК) вместо железа работает заглушка: выборки берутся
+      из analogRead() с темпом реального АЦП либо подкладываются вручную
+*/
+
+// Разрядность АЦП
+const uint8_t ADC_RESOLUTION_BITS = 10;
+
+// Наибольшее количество входов, опрашиваемых по кругу
+const uint8_t ADC_MAX_CHANNELS = 4;
+
+// Размер кольцевого буфера выборок (обязательно степень двойки)
+const uint8_t ADC_BUFFER_SIZE = 32;
+
+// Количество преобразований за один вызов adc_sleepConversions() из loop()
+const uint8_t ADC_SLEEP_BLOCK = 16;
+
+// Длительность одного преобразования (мкс) при делителе 128 на 16 МГц
+const uint16_t ADC_CONVERSION_US = 104;
+
+// Наибольший допуск adc_burstConfident(), 1/16 ед. АЦП
+const uint8_t ADC_MAX_TOLERANCE_X16 = 64;
+
+// Допустимые делители частоты АЦП (степень двойки): от 4 до 128.
+// Полная точность 10 бит гарантируется до делителя 64 (250 кГц),
+// с делителем 16 (1 МГц) остаётся около 8-9 бит, недостающее
+// добирается передискретизацией
+const uint8_t ADC_PRESCALER_MIN_LOG2 = 2;
+const uint8_t ADC_PRESCALER_MAX_LOG2 = 7;
+
+void adc_begin(uint8_t pin);        // выбор пина, отключение цифрового входа
+void adc_begin(const uint8_t *pins, uint8_t count);  // несколько пинов по кругу
+uint8_t adc_channels();             // количество опрашиваемых входов
+void adc_start();                   // очистить буфер и запустить АЦП
+void adc_stop();                    // остановить АЦП и забыть недобранный пакет
+void adc_flush();                   // выбросить накопленные выборки
+uint8_t adc_available();            // количество выборок в буфере
+uint16_t adc_read();                // взять одну выборку (0, если буфер пуст)
+uint16_t adc_readBlock(uint32_t &sum, uint16_t max_count);  // забрать до max_count выборок в сумму, вернуть их количество
+uint16_t adc_overruns();            // сколько выборок потеряно из-за переполнения буфера
+
+void adc_startBurst(uint16_t count, bool variance = false);  // запустить АЦП и просуммировать по count выборок каждого входа в прерывании (variance - и квадраты отклонений)
+bool adc_burstReady();                // пакет набран
+void adc_stopBurst();                 // закончить пакет досрочно
+uint32_t adc_burstSum(uint8_t channel = 0);     // сумма выборок пакета по входу
+uint16_t adc_burstCount(uint8_t channel = 0);   // сколько выборок входа набрано
+// Доверительный интервал среднего входа (2 сигмы) не шире
+// +-tolerance_x16 / 16 ед. АЦП и набрано не меньше min_count выборок.
+// Только для пакета с variance
+bool adc_burstConfident(uint8_t channel, uint8_t tolerance_x16,
+                        uint16_t min_count);
+
+void adc_setPrescaler(uint8_t log2_divider);  // делитель частоты АЦП (2^log2_divider)
+uint8_t adc_prescaler();                      // текущий log2 делителя
+uint16_t adc_conversionUs();                  // длительность преобразования при текущем делителе, мкс
+
+void adc_setNoiseReduction(bool enable);  // включить режим подавления шума
+void adc_sleepConversions(uint8_t count); // в режиме подавления шума: выполнить count преобразований во сне
+
+#ifndef __AVR__
+void adc_stubPush(uint16_t sample);  // заглушка: положить выборку в буфер
+#endif
+
+#endif
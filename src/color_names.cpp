@@ -0,0 +1,60 @@
+#include "color_names.hpp"
+
+struct NamedColorSearch {
+    int16_t target[3];
+    uint16_t best;
+    uint32_t best_distance;
+};
+
+static uint32_t colornames_distance2(const int16_t first[3],
+                                     const int16_t second[3]) {
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < 3; ++i) {
+        int32_t d = first[i] - second[i];
+        sum += (uint32_t)(d * d);
+    }
+    return sum;
+}
+
+// Рекурсия по диапазону [lo, hi), глубина - log2 размера палитры
+static void colornames_search(NamedColorSearch &search, uint16_t lo,
+                              uint16_t hi, uint8_t axis) {
+    if (lo >= hi)
+        return;
+    uint16_t middle = lo + (hi - lo) / 2;
+    int16_t node[3];
+    memcpy_P(node, NAMED_COLORS[middle].lab, sizeof(node));
+
+    uint32_t distance = colornames_distance2(search.target, node);
+    if (distance < search.best_distance) {
+        search.best_distance = distance;
+        search.best = middle;
+        if (!distance)
+            return;
+    }
+
+    uint8_t next = axis == 2 ? 0 : axis + 1;
+    int32_t offset = search.target[axis] - node[axis];
+    if (offset < 0) {
+        colornames_search(search, lo, middle, next);
+        if ((uint32_t)(offset * offset) < search.best_distance)
+            colornames_search(search, middle + 1, hi, next);
+    } else {
+        colornames_search(search, middle + 1, hi, next);
+        if ((uint32_t)(offset * offset) < search.best_distance)
+            colornames_search(search, lo, middle, next);
+    }
+}
+
+uint16_t colornames_find(const ColorLab &color, uint16_t &distance) {
+    NamedColorSearch search = {{color.l, color.a, color.b}, 0, UINT32_MAX};
+    colornames_search(search, 0, NAMED_COLORS_COUNT, 0);
+    ColorLab best;
+    memcpy_P(&best, NAMED_COLORS[search.best].lab, sizeof(best));
+    distance = color_deltaE(color, best);
+    return search.best;
+}
+
+void colornames_name(uint16_t index, char name[COLOR_NAME_LENGTH + 1]) {
+    memcpy_P(name, NAMED_COLORS[index].name, COLOR_NAME_LENGTH + 1);
+}
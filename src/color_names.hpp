@@ -0,0 +1,35 @@
+#ifndef COLOR_NAMES_HPP
+#define COLOR_NAMES_HPP
+
+#include <Arduino.h>
+
+#include "color_space.hpp"
+
+/*
+    Поиск ближайшего именованного цвета палитры.
+    - Палитра во flash (color_palette.cpp) создаётся tools/gen_palette.py
+      из CSV и уже разложена как k-d дерево в L*a*b*: средний элемент
+      диапазона делит его по оси L*, a*, b* (по очереди с глубиной)
+    - Расстояние - квадрат дельты E (CIE76) в целых числах; поддерево не
+      просматривается, если до его разделяющей плоскости дальше, чем до
+      уже найденного цвета
+    - Для палитры из ~150 цветов просматривается 15-30 узлов
+*/
+
+// Длина названия цвета (ровно столько помещается на экране после #RRGGBB)
+const uint8_t COLOR_NAME_LENGTH = 8;
+
+struct NamedColor {
+    int16_t lab[3];  // L*, a*, b* x100
+    char name[COLOR_NAME_LENGTH + 1];
+};
+
+extern const NamedColor NAMED_COLORS[] PROGMEM;
+extern const uint16_t NAMED_COLORS_COUNT;
+
+// Номер ближайшего цвета палитры, distance - дельта E x100 до него
+uint16_t colornames_find(const ColorLab &color, uint16_t &distance);
+// Название цвета палитры (с завершающим нулём)
+void colornames_name(uint16_t index, char name[COLOR_NAME_LENGTH + 1]);
+
+#endif
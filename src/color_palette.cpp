@@ -0,0 +1,148 @@
+// Создано tools/gen_palette.py из css_colors.csv, не редактировать вручную
+#include "color_names.hpp"
+
+// k-d дерево в L*a*b* x100, см. color_names.hpp
+const NamedColor NAMED_COLORS[] PROGMEM = {
+    {{3126, -1172, -372}, "dkslateg"},  // #2F4F4F
+    {{4825, -2885, -848}, "teal"},  // #008080
+    {{0, 0, 0}, "black"},  // #000000
+    {{4441, 0, 0}, "dimgray"},  // #696969
+    {{3083, 2605, -4208}, "dkslateb"},  // #483D8B
+    {{4783, 2626, -6526}, "royalblu"},  // #4169E1
+    {{4534, 3604, -5777}, "slateblu"},  // #6A5ACD
+    {{1586, 3171, -4957}, "midnight"},  // #191970
+    {{5221, -3062, -900}, "darkcyan"},  // #008B8B
+    {{5247, -408, -3219}, "steelblu"},  // #4682B4
+    {{5592, -225, -1111}, "lightsla"},  // #778899
+    {{6115, -1968, -742}, "cadetblu"},  // #5F9EA0
+    {{6579, -3751, -633}, "lightsea"},  // #20B2AA
+    {{5284, -214, -1057}, "slategra"},  // #708090
+    {{5938, 996, -6339}, "dodgerbl"},  // #1E90FF
+    {{6193, 933, -4930}, "cornflow"},  // #6495ED
+    {{5359, 0, 0}, "gray"},  // #808080
+    {{6924, 0, 0}, "darkgray"},  // #A9A9A9
+    {{3620, -4337, 4186}, "darkgree"},  // #006400
+    {{5153, -3972, 2005}, "seagreen"},  // #2E8B57
+    {{5059, -4959, 4502}, "forestgr"},  // #228B22
+    {{4623, -5170, 4990}, "green"},  // #008000
+    {{4223, -1883, 3060}, "darkoliv"},  // #556B2F
+    {{4380, 2932, 3564}, "sienna"},  // #A0522D
+    {{3747, 2644, 4098}, "saddlebr"},  // #8B4513
+    {{5187, -1293, 5667}, "olive"},  // #808000
+    {{5465, -2822, 4969}, "olivedra"},  // #6B8E23
+    {{7209, -2382, 1804}, "darkseag"},  // #8FBC8F
+    {{6527, -4822, 2429}, "mediumse"},  // #3CB371
+    {{7082, 852, 6876}, "goldenro"},  // #DAA520
+    {{5922, 986, 6273}, "darkgold"},  // #B8860B
+    {{6361, 1701, 661}, "rosybrow"},  // #BC8F8F
+    {{6986, 2817, 2771}, "darksalm"},  // #E9967A
+    {{6175, 2140, 4792}, "peru"},  // #CD853F
+    {{5497, 3680, -5009}, "mediumpu"},  // #9370DB
+    {{1297, 4750, -6470}, "navy"},  // #000080
+    {{1475, 5042, -6868}, "darkblue"},  // #00008B
+    {{2047, 5169, -5331}, "indigo"},  // #4B0082
+    {{3290, 4288, -4715}, "rebeccap"},  // #663399
+    {{2978, 5893, -3649}, "purple"},  // #800080
+    {{3230, 7919, -10786}, "blue"},  // #0000FF
+    {{2497, 6718, -9150}, "mediumbl"},  // #0000CD
+    {{3260, 6255, -3873}, "darkmage"},  // #8B008B
+    {{3958, 7632, -7037}, "darkviol"},  // #9400D3
+    {{5216, 4107, -6540}, "mediumsl"},  // #7B68EE
+    {{5364, 5906, -4740}, "mediumor"},  // #BA55D3
+    {{6970, 5636, -3681}, "violet"},  // #EE82EE
+    {{6280, 5528, -3440}, "orchid"},  // #DA70D6
+    {{4338, 6515, -6010}, "darkorch"},  // #9932CC
+    {{4219, 6984, -7476}, "blueviol"},  // #8A2BE2
+    {{6032, 9823, -6082}, "fuchsia"},  // #FF00FF
+    {{4477, 7099, -1517}, "mediumvi"},  // #C71585
+    {{6549, 6424, -1065}, "hotpink"},  // #FF69B4
+    {{3753, 4969, 3054}, "brown"},  // #A52A2A
+    {{5340, 4483, 2212}, "indianre"},  // #CD5C5C
+    {{2554, 4805, 3806}, "maroon"},  // #800000
+    {{2809, 5100, 4129}, "darkred"},  // #8B0000
+    {{3912, 5592, 3765}, "firebric"},  // #B22222
+    {{5596, 8454, -570}, "deeppink"},  // #FF1493
+    {{4704, 7092, 3360}, "crimson"},  // #DC143C
+    {{5324, 8009, 6720}, "red"},  // #FF0000
+    {{5599, 3705, 5674}, "chocolat"},  // #D2691E
+    {{6616, 4281, 1956}, "lightcor"},  // #F08080
+    {{6726, 4523, 2909}, "salmon"},  // #FA8072
+    {{6949, 3683, 7549}, "darkoran"},  // #FF8C00
+    {{6730, 4535, 4749}, "coral"},  // #FF7F50
+    {{6057, 4552, 40}, "paleviol"},  // #DB7093
+    {{6221, 5785, 4642}, "tomato"},  // #FF6347
+    {{5758, 6778, 6896}, "orangere"},  // #FF4500
+    {{7255, -1766, -4254}, "deepskyb"},  // #00BFFF
+    {{7529, -4004, -1351}, "darkturq"},  // #00CED1
+    {{7688, -3736, -835}, "mediumtu"},  // #48D1CC
+    {{8126, -4408, -403}, "turquois"},  // #40E0D0
+    {{7569, -3834, 831}, "mediumaq"},  // #66CDAA
+    {{7921, -1484, -2128}, "skyblue"},  // #87CEEB
+    {{7972, -1083, -2850}, "lightsky"},  // #87CEFA
+    {{8381, -1089, -1148}, "lightblu"},  // #ADD8E6
+    {{8613, -1409, -801}, "powderbl"},  // #B0E0E6
+    {{9006, -1964, -640}, "paleturq"},  // #AFEEEE
+    {{9111, -4809, -1413}, "aqua"},  // #00FFFF
+    {{9787, -994, -338}, "lightcya"},  // #E0FFFF
+    {{9857, -756, 548}, "honeydew"},  // #F0FFF0
+    {{9203, -4552, 972}, "aquamari"},  // #7FFFD4
+    {{9893, -488, -169}, "azure"},  // #F0FFFF
+    {{9916, -416, 125}, "mintcrea"},  // #F5FFFA
+    {{9964, -255, 716}, "ivory"},  // #FFFFF0
+    {{9595, -419, 1205}, "beige"},  // #F5F5DC
+    {{9929, -511, 1484}, "lightyel"},  // #FFFFE0
+    {{8734, -7069, 3246}, "mediumsp"},  // #00FA9A
+    {{8847, -7690, 4703}, "springgr"},  // #00FF7F
+    {{8773, -8618, 8318}, "lime"},  // #00FF00
+    {{8888, -6786, 8495}, "lawngree"},  // #7CFC00
+    {{7261, -6713, 6144}, "limegree"},  // #32CD32
+    {{8655, -4633, 3695}, "lightgre"},  // #90EE90
+    {{7338, -879, 3929}, "darkkhak"},  // #BDB76B
+    {{7653, -3799, 6659}, "yellowgr"},  // #9ACD32
+    {{8987, -6807, 8578}, "chartreu"},  // #7FFF00
+    {{9075, -4830, 3853}, "palegree"},  // #98FB98
+    {{9196, -5248, 8186}, "greenyel"},  // #ADFF2F
+    {{9714, -2155, 9448}, "yellow"},  // #FFFF00
+    {{9033, -901, 4498}, "khaki"},  // #F0E68C
+    {{9737, -648, 1924}, "ltgoldye"},  // #FAFAD2
+    {{9765, -543, 2223}, "lemonchi"},  // #FFFACD
+    {{9114, -735, 3097}, "palegold"},  // #EEE8AA
+    {{9746, -222, 1429}, "cornsilk"},  // #FFF8DC
+    {{7770, 0, 0}, "silver"},  // #C0C0C0
+    {{7845, -128, -1521}, "lightste"},  // #B0C4DE
+    {{8456, 0, 0}, "lightgra"},  // #D3D3D3
+    {{8776, 0, 0}, "gainsbor"},  // #DCDCDC
+    {{8008, 1322, -923}, "thistle"},  // #D8BFD8
+    {{7337, 3253, -2199}, "plum"},  // #DDA0DD
+    {{8359, 2414, 333}, "pink"},  // #FFC0CB
+    {{8105, 2796, 504}, "lightpin"},  // #FFB6C1
+    {{9183, 371, -966}, "lavender"},  // #E6E6FA
+    {{9718, -135, -426}, "aliceblu"},  // #F0F8FF
+    {{9776, 125, -335}, "ghostwhi"},  // #F8F8FF
+    {{9654, 0, 0}, "whitesmo"},  // #F5F5F5
+    {{10000, 0, 0}, "white"},  // #FFFFFF
+    {{9864, 166, 59}, "snow"},  // #FFFAFA
+    {{9607, 589, -59}, "lavblush"},  // #FFF0F5
+    {{9712, 216, 455}, "seashell"},  // #FFF5EE
+    {{9266, 875, 484}, "mistyros"},  // #FFE4E1
+    {{9840, -4, 538}, "floralwh"},  // #FFFAF0
+    {{7498, 502, 2443}, "tan"},  // #D2B48C
+    {{8935, 151, 2401}, "wheat"},  // #F5DEB3
+    {{7702, 705, 3002}, "burlywoo"},  // #DEB887
+    {{8693, -192, 8713}, "gold"},  // #FFD700
+    {{8935, 809, 2102}, "peachpuf"},  // #FFDAB9
+    {{7471, 3148, 3455}, "lightsal"},  // #FFA07A
+    {{7395, 2303, 4679}, "sandybro"},  // #F4A460
+    {{7494, 2393, 7895}, "orange"},  // #FFA500
+    {{9010, 451, 2827}, "navajowh"},  // #FFDEAD
+    {{9531, 168, 602}, "linen"},  // #FAF0E6
+    {{9678, 17, 817}, "oldlace"},  // #FDF5E6
+    {{9508, 127, 1453}, "papayawh"},  // #FFEFD5
+    {{9373, 184, 1153}, "antiquew"},  // #FAEBD7
+    {{9392, 213, 1703}, "blanched"},  // #FFEBCD
+    {{9201, 443, 1901}, "bisque"},  // #FFE4C4
+    {{9172, 244, 2636}, "moccasin"}  // #FFE4B5
+};
+
+const uint16_t NAMED_COLORS_COUNT =
+    sizeof(NAMED_COLORS) / sizeof(NAMED_COLORS[0]);
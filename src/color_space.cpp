@@ -0,0 +1,212 @@
+#include "color_space.hpp"
+
+// sRGB -> линейная яркость, 1.0 = 65535
+static const uint16_t SRGB_TO_LINEAR[256] PROGMEM = {
+    0, 20, 40, 60, 80, 99, 119, 139, 159, 179,
+    199, 219, 241, 264, 288, 313, 340, 367, 396, 427,
+    458, 491, 526, 562, 599, 637, 677, 718, 761, 805,
+    851, 898, 947, 997, 1048, 1101, 1156, 1212, 1270, 1330,
+    1391, 1453, 1517, 1583, 1651, 1720, 1790, 1863, 1937, 2013,
+    2090, 2170, 2250, 2333, 2418, 2504, 2592, 2681, 2773, 2866,
+    2961, 3058, 3157, 3258, 3360, 3464, 3570, 3678, 3788, 3900,
+    4014, 4129, 4247, 4366, 4488, 4611, 4736, 4864, 4993, 5124,
+    5257, 5392, 5530, 5669, 5810, 5953, 6099, 6246, 6395, 6547,
+    6700, 6856, 7014, 7174, 7335, 7500, 7666, 7834, 8004, 8177,
+    8352, 8528, 8708, 8889, 9072, 9258, 9445, 9635, 9828, 10022,
+    10219, 10417, 10619, 10822, 11028, 11235, 11446, 11658, 11873, 12090,
+    12309, 12530, 12754, 12980, 13209, 13440, 13673, 13909, 14146, 14387,
+    14629, 14874, 15122, 15371, 15623, 15878, 16135, 16394, 16656, 16920,
+    17187, 17456, 17727, 18001, 18277, 18556, 18837, 19121, 19407, 19696,
+    19987, 20281, 20577, 20876, 21177, 21481, 21787, 22096, 22407, 22721,
+    23038, 23357, 23678, 24002, 24329, 24658, 24990, 25325, 25662, 26001,
+    26344, 26688, 27036, 27386, 27739, 28094, 28452, 28813, 29176, 29542,
+    29911, 30282, 30656, 31033, 31412, 31794, 32179, 32567, 32957, 33350,
+    33745, 34143, 34544, 34948, 35355, 35764, 36176, 36591, 37008, 37429,
+    37852, 38278, 38706, 39138, 39572, 40009, 40449, 40891, 41337, 41785,
+    42236, 42690, 43147, 43606, 44069, 44534, 45002, 45473, 45947, 46423,
+    46903, 47385, 47871, 48359, 48850, 49344, 49841, 50341, 50844, 51349,
+    51858, 52369, 52884, 53401, 53921, 54445, 54971, 55500, 56032, 56567,
+    57105, 57646, 58190, 58737, 59287, 59840, 60396, 60955, 61517, 62082,
+    62650, 63221, 63795, 64372, 64952, 65535};
+
+// Кубический корень на отрезке [0, 1] с шагом 1/256, 1.0 = 65535
+static const uint16_t CUBE_ROOT[257] PROGMEM = {
+    0, 10321, 13004, 14886, 16384, 17649, 18755, 19744, 20642, 21469,
+    22236, 22954, 23629, 24268, 24875, 25454, 26008, 26538, 27049, 27541,
+    28016, 28475, 28920, 29352, 29771, 30179, 30576, 30963, 31341, 31710,
+    32070, 32423, 32768, 33105, 33436, 33761, 34080, 34392, 34699, 35001,
+    35298, 35589, 35876, 36159, 36437, 36711, 36981, 37247, 37509, 37768,
+    38023, 38275, 38524, 38769, 39011, 39251, 39487, 39721, 39952, 40180,
+    40406, 40629, 40850, 41068, 41284, 41498, 41710, 41920, 42127, 42333,
+    42536, 42738, 42938, 43135, 43332, 43526, 43718, 43909, 44099, 44286,
+    44472, 44657, 44840, 45021, 45202, 45380, 45557, 45733, 45908, 46081,
+    46253, 46424, 46593, 46761, 46928, 47094, 47259, 47422, 47585, 47746,
+    47906, 48066, 48224, 48381, 48537, 48692, 48846, 48999, 49151, 49302,
+    49453, 49602, 49751, 49898, 50045, 50191, 50336, 50480, 50624, 50766,
+    50908, 51049, 51189, 51329, 51468, 51606, 51743, 51879, 52015, 52150,
+    52285, 52418, 52551, 52684, 52816, 52947, 53077, 53207, 53336, 53464,
+    53592, 53720, 53846, 53972, 54098, 54223, 54347, 54471, 54594, 54717,
+    54839, 54961, 55082, 55202, 55322, 55442, 55561, 55679, 55797, 55915,
+    56032, 56148, 56264, 56380, 56495, 56609, 56723, 56837, 56950, 57063,
+    57175, 57287, 57399, 57510, 57620, 57731, 57840, 57950, 58059, 58167,
+    58275, 58383, 58490, 58597, 58704, 58810, 58916, 59021, 59126, 59231,
+    59335, 59439, 59542, 59646, 59749, 59851, 59953, 60055, 60156, 60257,
+    60358, 60459, 60559, 60659, 60758, 60857, 60956, 61054, 61153, 61250,
+    61348, 61445, 61542, 61639, 61735, 61831, 61927, 62022, 62117, 62212,
+    62307, 62401, 62495, 62589, 62682, 62775, 62868, 62961, 63053, 63145,
+    63237, 63328, 63419, 63510, 63601, 63692, 63782, 63872, 63962, 64051,
+    64140, 64229, 64318, 64406, 64495, 64583, 64670, 64758, 64845, 64932,
+    65019, 65106, 65192, 65278, 65364, 65450, 65535};
+
+// Строки матрицы sRGB -> XYZ, поделённые на белую точку D65 (Xn, Yn, Zn).
+// Сумма каждой строки ровно 65536, белый даёт ровно 1.0
+static const uint16_t RGB_TO_XYZ_NORMALIZED[3][3] PROGMEM = {
+    {28439, 24655, 12442}, {13938, 46868, 4730}, {1164, 7174, 57198}};
+
+// Белая точка D65 x10000
+static const uint16_t WHITE_POINT[3] PROGMEM = {9505, 10000, 10888};
+
+// Порог линейного участка L*a*b*: (6/29)^3 = 0.008856 в единицах 1/65535
+static const uint16_t LAB_LINEAR_LIMIT = 580;
+
+// X/Xn, Y/Yn, Z/Zn, 1.0 = 65535
+static void color_toNormalizedXyz(uint8_t r, uint8_t g, uint8_t b,
+                                  uint16_t out[3]) {
+    uint16_t linear[3] = {pgm_read_word(&SRGB_TO_LINEAR[r]),
+                          pgm_read_word(&SRGB_TO_LINEAR[g]),
+                          pgm_read_word(&SRGB_TO_LINEAR[b])};
+    for (uint8_t row = 0; row < 3; ++row) {
+        // Коэффициенты в сумме дают 65536, переполнения нет
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < 3; ++i)
+            sum += (uint32_t)pgm_read_word(&RGB_TO_XYZ_NORMALIZED[row][i]) *
+                   linear[i];
+        out[row] = sum >> 16;
+    }
+}
+
+// f(t) из определения L*a*b*, 1.0 = 65535
+static uint16_t color_labF(uint16_t t) {
+    if (t <= LAB_LINEAR_LIMIT)
+        // t * 841/108 + 4/29
+        return (((uint32_t)t * 510328) >> 16) + 9039;
+    // Вблизи нуля корень слишком изогнут для линейной интерполяции:
+    // cbrt(t) = cbrt(8t) / 2, поэтому переносим t в пологую часть таблицы
+    uint8_t halvings = 0;
+    while (t < 8192) {
+        t <<= 3;
+        halvings++;
+    }
+    uint8_t index = t >> 8;
+    uint8_t fraction = t;
+    uint16_t low = pgm_read_word(&CUBE_ROOT[index]);
+    uint16_t high = pgm_read_word(&CUBE_ROOT[index + 1]);
+    return (low + (((uint32_t)(high - low) * fraction + 128) >> 8)) >>
+           halvings;
+}
+
+void color_toHsv(uint8_t r, uint8_t g, uint8_t b, int16_t hsv[3]) {
+    uint8_t high = max(r, max(g, b));
+    uint8_t low = min(r, min(g, b));
+    uint8_t delta = high - low;
+    int16_t hue = 0;
+    if (delta) {
+        // Сектор 60 градусов, внутри - доля разности двух других цветов
+        int16_t offset, part;
+        if (high == r) {
+            offset = 0;
+            part = g - b;
+        } else if (high == g) {
+            offset = 120;
+            part = b - r;
+        } else {
+            offset = 240;
+            part = r - g;
+        }
+        int16_t scaled = part * 60;
+        hue = offset + (scaled + (scaled < 0 ? -delta / 2 : delta / 2)) / delta;
+        if (hue < 0)
+            hue += 360;
+        else if (hue >= 360)
+            hue -= 360;
+    }
+    hsv[0] = hue;
+    hsv[1] = high ? ((uint16_t)delta * 255 + high / 2) / high : 0;
+    hsv[2] = high;
+}
+
+void color_toXyz(uint8_t r, uint8_t g, uint8_t b, int16_t xyz[3]) {
+    uint16_t normalized[3];
+    color_toNormalizedXyz(r, g, b, normalized);
+    for (uint8_t i = 0; i < 3; ++i)
+        xyz[i] = ((uint32_t)normalized[i] * pgm_read_word(&WHITE_POINT[i]) +
+                  32768) >> 16;
+}
+
+void color_toLab(uint8_t r, uint8_t g, uint8_t b, ColorLab &lab) {
+    uint16_t normalized[3];
+    color_toNormalizedXyz(r, g, b, normalized);
+    int32_t fx = color_labF(normalized[0]);
+    int32_t fy = color_labF(normalized[1]);
+    int32_t fz = color_labF(normalized[2]);
+    // L* = 116 fy - 16, a* = 500 (fx - fy), b* = 200 (fy - fz); всё x100.
+    // Множители 50000 и 20000 поделены на 16, чтобы не выйти за int32
+    lab.l = ((fy * 11600 + 32768) >> 16) - 1600;
+    lab.a = ((fx - fy) * 3125 + 2048) >> 12;
+    lab.b = ((fy - fz) * 1250 + 2048) >> 12;
+}
+
+void color_convert(ColorSpace space, uint8_t r, uint8_t g, uint8_t b,
+                   int16_t out[3]) {
+    switch (space) {
+        case SpaceHsv:
+            color_toHsv(r, g, b, out);
+            return;
+        case SpaceXyz:
+            color_toXyz(r, g, b, out);
+            return;
+        case SpaceLab: {
+            ColorLab lab;
+            color_toLab(r, g, b, lab);
+            out[0] = lab.l;
+            out[1] = lab.a;
+            out[2] = lab.b;
+            return;
+        }
+        default:
+            out[0] = r;
+            out[1] = g;
+            out[2] = b;
+            return;
+    }
+}
+
+// Целый квадратный корень, по биту за шаг
+static uint16_t isqrt32(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value)
+        bit >>= 2;
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+uint32_t color_distance2(const ColorLab &first, const ColorLab &second) {
+    int32_t dl = first.l - second.l;
+    int32_t da = first.a - second.a;
+    int32_t db = first.b - second.b;
+    // Каждая разность не больше ~25600, сумма квадратов помещается в uint32
+    return (uint32_t)(dl * dl) + (uint32_t)(da * da) + (uint32_t)(db * db);
+}
+
+uint16_t color_deltaE(const ColorLab &first, const ColorLab &second) {
+    return isqrt32(color_distance2(first, second));
+}
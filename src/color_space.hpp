@@ -0,0 +1,48 @@
+#ifndef COLOR_SPACE_HPP
+#define COLOR_SPACE_HPP
+
+#include <Arduino.h>
+
+/*
+    Перевод цвета из RGB (0-255, sRGB) в другие цветовые пространства.
+    - Только целочисленная арифметика, таблицы во flash: гамма sRGB
+      (256 значений) и кубический корень для L*a*b* (257 узлов с
+      линейной интерполяцией)
+    - Матрица sRGB -> XYZ заранее поделена на белую точку D65, поэтому
+      для L*a*b* не нужно ни одного деления
+    - Компоненты в целых единицах:
+        HSV   - H 0-359 градусов, S и V 0-255
+        XYZ   - x10000 (Y белого = 10000)
+        L*a*b - x100 (L* 0-10000, a* и b* примерно -12800..12800)
+    - Отклонение от расчёта в double по всем 2^24 цветам: H и S - до 0.5,
+      XYZ - до 1.2 ед. (x10000), L* - до 0.03, a* - до 0.085, b* - до
+      0.045 (test/test_color_space)
+*/
+
+// Цветовые пространства для вывода
+enum ColorSpace : uint8_t {
+    SpaceRgb = 0,
+    SpaceHsv,
+    SpaceXyz,
+    SpaceLab,
+    ColorSpaces
+};
+
+struct ColorLab {
+    int16_t l, a, b;  // x100
+};
+
+void color_toHsv(uint8_t r, uint8_t g, uint8_t b, int16_t hsv[3]);
+void color_toXyz(uint8_t r, uint8_t g, uint8_t b, int16_t xyz[3]);
+void color_toLab(uint8_t r, uint8_t g, uint8_t b, ColorLab &lab);
+
+// Три компоненты цвета в выбранном пространстве
+void color_convert(ColorSpace space, uint8_t r, uint8_t g, uint8_t b,
+                   int16_t out[3]);
+
+// Квадрат расстояния в L*a*b* (x100 в квадрате), для сравнений без корня
+uint32_t color_distance2(const ColorLab &first, const ColorLab &second);
+// Цветовое различие CIE76 (дельта E*ab) x100
+uint16_t color_deltaE(const ColorLab &first, const ColorLab &second);
+
+#endif
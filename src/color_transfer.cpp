@@ -0,0 +1,95 @@
+#include "color_transfer.hpp"
+
+#include <math.h>
+
+// Освещённость по уровню АЦП в относительных единицах:
+// R_ldr / R = L / (1023 - L), E ~ (R_ldr / R)^(-1 / gamma)
+static float transfer_light(float level, float gamma) {
+    level = constrain(level, 0.5f, 1022.5f);
+    return pow(level / (1023 - level), -1 / gamma);
+}
+
+// Позиция 1 + 15 * t (t - доля шкалы от белого) растёт вдвое за октаву
+static const uint8_t TRANSFER_POSITION_SPAN = (1 << TRANSFER_OCTAVES) - 1;
+static const uint8_t TRANSFER_POSITION_BITS = 20;
+
+// Доля шкалы узла i
+static float transfer_share(uint8_t i) {
+    uint8_t octave = i >> TRANSFER_OCTAVE_BITS;
+    uint8_t step = i & ((1 << TRANSFER_OCTAVE_BITS) - 1);
+    if (octave >= TRANSFER_OCTAVES)
+        return 1;
+    float position =
+        (1 << octave) * (1 + (float)step / (1 << TRANSFER_OCTAVE_BITS));
+    return (position - 1) / TRANSFER_POSITION_SPAN;
+}
+
+void ColorTransfer::build(uint16_t white, uint16_t black, float gamma) {
+    if (black <= white)
+        black = white + 1;
+    _white = white;
+    _black = black;
+    uint16_t span = black - white;
+    _scale =
+        ((uint32_t)TRANSFER_POSITION_SPAN << TRANSFER_POSITION_BITS) / span;
+
+    float light_white = 0, light_black = 0;
+    if (gamma > 0) {
+        light_white = transfer_light(white, gamma);
+        light_black = transfer_light(black, gamma);
+        // Оба уровня на краю модели (1023): света не различить, шкала
+        // остаётся линейной
+        if (light_white <= light_black)
+            gamma = 0;
+    }
+    _linearised = gamma > 0;
+    for (uint8_t i = 0; i <= TRANSFER_SEGMENTS; ++i) {
+        float share = transfer_share(i);
+        if (gamma > 0)
+            share = (light_white -
+                     transfer_light(white + span * share, gamma)) /
+                    (light_white - light_black);
+        _knots[i] = constrain(lround(255 * (1 - share)), 0, 255);
+    }
+}
+
+uint16_t ColorTransfer::interpolate(uint16_t level) const {
+    if (level <= _white)
+        return _knots[0] << 8;
+    if (level >= _black)
+        return _knots[TRANSFER_SEGMENTS] << 8;
+    // Позиция с 20 дробными битами: от 2^20 у белого до 16 * 2^20 у
+    // чёрного. (level - white) < span, поэтому произведение в 32 битах
+    uint32_t position = ((uint32_t)1 << TRANSFER_POSITION_BITS) +
+                        (uint32_t)(level - _white) * _scale;
+    uint8_t octave = 0;
+    while (octave + 1 < TRANSFER_OCTAVES &&
+           position >= ((uint32_t)2 << TRANSFER_POSITION_BITS)) {
+        position >>= 1;
+        octave++;
+    }
+    if (position >= ((uint32_t)2 << TRANSFER_POSITION_BITS))
+        return _knots[TRANSFER_SEGMENTS] << 8;
+    // Под старшим битом: 3 бита - отрезок в октаве, 8 бит - доля в нём
+    uint16_t mantissa =
+        position >> (TRANSFER_POSITION_BITS - TRANSFER_OCTAVE_BITS - 8);
+    uint8_t segment = (octave << TRANSFER_OCTAVE_BITS) |
+                      ((mantissa >> 8) & ((1 << TRANSFER_OCTAVE_BITS) - 1));
+    uint8_t fraction = mantissa;
+    int16_t step = _knots[segment + 1] - _knots[segment];
+    return (_knots[segment] << 8) + (int32_t)step * fraction;
+}
+
+uint8_t ColorTransfer::apply(uint16_t level) const {
+    return (interpolate(level) + 128) >> 8;
+}
+
+// Деление 16-битного результата, а не готовой яркости: при скважности
+// 64 из 255 иначе терялись бы 2 младших бита
+uint8_t ColorTransfer::apply(uint16_t level, uint8_t duty) const {
+    if (duty == 255 || !duty)
+        return apply(level);
+    uint32_t value = ((uint32_t)interpolate(level) * 255 + duty * 128u) /
+                     ((uint32_t)duty << 8);
+    return value > 255 ? 255 : value;
+}
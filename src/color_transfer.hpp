@@ -0,0 +1,59 @@
+#ifndef COLOR_TRANSFER_HPP
+#define COLOR_TRANSFER_HPP
+
+#include <Arduino.h>
+
+/*
+    Передаточная функция канала: уровень АЦП (0-1023) -> яркость (0-255).
+    - Таблица из TRANSFER_SEGMENTS + 1 узлов строится один раз при
+      калибровке, дальше каждое значение - умножение на обратный
+      коэффициент и линейная интерполяция между соседними узлами,
+      без деления и без float
+    - Узлы сгущаются к белому концу шкалы, где кривая фоторезистора
+      круче всего: позиция 1 + 15 * (level - white) / (black - white)
+      проходит 4 октавы (1-2, 2-4, 4-8, 8-16) по 8 равных отрезков в
+      каждой. Октава - старший бит позиции, отрезок - следующие 3 бита,
+      как порядок и мантисса у float. Первый отрезок - 1/120 шкалы,
+      последний - 1/15. Отличие от точной формулы не больше 1.3 ед. при
+      белом образце от 100 ед. АЦП (равномерные 32 отрезка давали до 6)
+    - Фоторезистор стоит в нижнем плече делителя: чем больше света, тем
+      меньше уровень. Его сопротивление пропорционально E^-gamma, поэтому
+      уровень нелинеен по освещённости. Узлы таблицы считаются по этой
+      модели, так что результат пропорционален отражённому свету.
+      gamma = 0 - линейная шкала между белым и чёрным
+    - Результат линеен по свету, поэтому уровень, снятый при неполной
+      яркости светодиода (скважность duty из 255), пересчитывается
+      к полной делением на duty / 255. Фон при этом считается равным
+      свету на чёрном образце
+*/
+
+// Количество октав позиции и отрезков в каждой
+const uint8_t TRANSFER_OCTAVES = 4;
+const uint8_t TRANSFER_OCTAVE_BITS = 3;
+// Количество отрезков таблицы
+const uint8_t TRANSFER_SEGMENTS = TRANSFER_OCTAVES << TRANSFER_OCTAVE_BITS;
+
+class ColorTransfer {
+  public:
+    // white, black - уровни АЦП на белом и чёрном образцах
+    void build(uint16_t white, uint16_t black, float gamma);
+    uint8_t apply(uint16_t level) const;
+    // Уровень снят при скважности светодиода duty (1-255)
+    uint8_t apply(uint16_t level, uint8_t duty) const;
+    // Яркость x256 (0-65280) без округления, для отношений яркостей
+    uint16_t interpolate(uint16_t level) const;
+    // Шкала построена по модели фоторезистора (gamma > 0): только тогда
+    // результат пропорционален свету и apply(level, duty) имеет смысл
+    bool isLinearised() const { return _linearised; }
+
+    uint16_t white() const { return _white; }
+    uint16_t black() const { return _black; }
+
+  private:
+    bool _linearised = false;
+    uint16_t _white = 0, _black = 1023;
+    uint32_t _scale = 0;  // шаг позиции на единицу АЦП, 20 дробных бит
+    uint8_t _knots[TRANSFER_SEGMENTS + 1] = {};
+};
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef HEAD_SCHEDULER_HPP
+#define HEAD_SCHEDULER_HPP
+
+#include <Arduino.h>
+
+#include "acquisition.hpp"
+#include "adc_sampler.hpp"
+#include "led_pwm.hpp"
+#include "settle_detector.hpp"
+
+/*
+    Измерение несколькими оптически развязанными датчиками, у каждого
+    свои светодиоды и свой вход АЦП.
+    - Фазы датчика идут по его таблице, как в AcquisitionSequencer, но
+      фазы разных датчиков перекрываются: пока у одного светодиод ещё
+      только включился (минимальная задержка установления), АЦП набирает
+      выборки другого
+    - АЦП в каждый момент у одного датчика: он проверяет установление
+      сигнала и набирает пакет выборок, затем АЦП освобождается
+    - Из датчиков, у которых прошла минимальная задержка, АЦП получает
+      тот, чей таймаут установления наступает раньше (earliest deadline
+      first). При равных сроках - следующий по кругу после прошлого
+      владельца, так что ни один датчик не ждёт дольше остальных
+    - HeadsSequential - датчики по очереди, следующий начинает, когда
+      предыдущий прошёл все фазы (для сравнения с перекрытием)
+    - Измерение заканчивается, когда все датчики прошли все фазы (или
+      count фаз от first). Интерфейс тот же, что у AcquisitionSequencer,
+      номер датчика - sensor
+*/
+
+enum HeadPolicy : uint8_t { HeadsSequential = 0, HeadsPipelined };
+
+template <uint8_t N, uint8_t H>
+class HeadScheduler {
+  public:
+    // phases - таблицы фаз датчиков в PROGMEM, pins - входы АЦП датчиков
+    HeadScheduler(const AcquisitionPhase (&phases)[H][N],
+                  const uint8_t (&pins)[H], SettleDetector &settle)
+        : _phases(phases), _pins(pins), _settle(settle) {
+        memset(_duty, 255, sizeof(_duty));
+    }
+
+    // Настроить пины светодиодов
+    void begin() {
+        for (uint8_t h = 0; h < H; ++h)
+            for (uint8_t i = 0; i < N; ++i)
+                led_begin(ledPin(i, h));
+    }
+
+    // Включить или выключить все светодиоды
+    void switchLeds(bool state) {
+        for (uint8_t h = 0; h < H; ++h)
+            for (uint8_t i = 0; i < N; ++i)
+                led_write(ledPin(i, h), state ? 255 : 0);
+    }
+
+    // Начать измерение: count фаз, начиная с first, у всех датчиков
+    // (по очереди - у первого)
+    void start(uint8_t first = 0, uint8_t count = N) {
+        _started = millis();
+        _owner = NO_HEAD;
+        _end = min(first + count, (int)N);
+        for (uint8_t h = 0; h < H; ++h) {
+            _phase[h] = first;
+            _state[h] = HeadIdle;
+        }
+        for (uint8_t h = 0; h < (_policy == HeadsPipelined ? H : 1); ++h)
+            enterPhase(h);
+        _running = true;
+    }
+
+    // Прервать измерение: светодиоды и АЦП выключаются, недобранный пакет
+    // выбрасывается, следующий start() начинает с проверки установления
+    void cancel() {
+        switchLeds(LOW);
+        adc_stopBurst();
+        adc_stop();
+        _owner = NO_HEAD;
+        _reading = false;
+        _running = false;
+    }
+
+    // Действует со следующего измерения
+    void setPolicy(HeadPolicy policy) { _policy = policy; }
+    HeadPolicy policy() { return _policy; }
+
+    // Количество выборок на уровень (0 - брать из таблицы фаз) и
+    // разрядность уровней. Действует со следующего измерения
+    void setOversampling(uint16_t ratio, uint8_t bits) {
+        _ratio = ratio;
+        _bits = constrain(bits, ADC_RESOLUTION_BITS, ACQUISITION_MAX_BITS);
+    }
+    uint16_t oversampling() { return _ratio; }
+    uint8_t resolution() { return _bits; }
+
+    // Досрочная остановка пакета, как в AcquisitionSequencer
+    void setEarlyStop(uint8_t tolerance_x16, uint16_t min_samples) {
+        _tolerance = min(tolerance_x16, ADC_MAX_TOLERANCE_X16);
+        _min_samples = max(min_samples, (uint16_t)2);
+    }
+    uint8_t earlyStopTolerance() { return _tolerance; }
+    uint16_t earlyStopMinSamples() { return _min_samples; }
+
+    boolean isRunning() { return _running; }
+    boolean isWaiting() { return _owner == NO_HEAD || !_reading; }
+
+    // Продвинуть измерение, вызывать из loop(). Возвращает true, когда
+    // все датчики прошли все фазы и готовы уровни level()
+    boolean tick() {
+        if (!_running || (_owner == NO_HEAD && !grant()))
+            return false;
+        adc_sleepConversions(ADC_SLEEP_BLOCK);
+        uint8_t head = _owner, phase = _phase[head];
+        if (!_reading) {
+            if (!_settle.isSettled())
+                return false;
+            _settle_times[head][phase] = _settle.settleTime();
+            adc_startBurst(_ratio ? _ratio : samples(phase, head), _tolerance);
+            _next_check = _min_samples;
+            _reading = true;
+            return false;
+        }
+        if (!adc_burstReady() && !confident())
+            return false;
+        adc_stopBurst();
+        _levels[head][phase] = decimate(adc_burstSum(), adc_burstCount());
+        _used[head][phase] = adc_burstCount();
+        led_write(ledPin(phase, head), 0);
+        adc_stop();
+        _owner = NO_HEAD;
+        _reading = false;
+        if (++_phase[head] < _end) {
+            enterPhase(head);
+            return false;
+        }
+        _state[head] = HeadDone;
+        _readings[head]++;
+        _busy_ms[head] += millis() - _started;
+        if (_policy == HeadsSequential && head + 1 < H) {
+            enterPhase(head + 1);
+            return false;
+        }
+        for (uint8_t h = 0; h < H; ++h)
+            if (_state[h] != HeadDone)
+                return false;
+        _running = false;
+        return true;
+    }
+
+    static constexpr uint8_t channels() { return N; }
+    static uint8_t sensors() { return H; }
+    static bool sharedLeds() { return false; }
+
+    uint8_t ledPin(uint8_t phase, uint8_t sensor = 0) {
+        return pgm_read_byte(&_phases[sensor][phase].led_pin);
+    }
+    uint8_t settleTimeout(uint8_t phase, uint8_t sensor = 0) {
+        return pgm_read_byte(&_phases[sensor][phase].settle_timeout);
+    }
+    uint16_t samples(uint8_t phase, uint8_t sensor = 0) {
+        return pgm_read_word(&_phases[sensor][phase].samples);
+    }
+    // Скважность светодиода фазы датчика (1-255). Действует со следующего
+    // включения светодиода
+    void setDuty(uint8_t phase, uint8_t duty, uint8_t sensor = 0) {
+        _duty[sensor][phase] = duty ? duty : 1;
+    }
+    uint8_t duty(uint8_t phase, uint8_t sensor = 0) {
+        return _duty[sensor][phase];
+    }
+
+    // Ячейки калибровки одинаковы у всех датчиков, берутся у первого
+    uint8_t slot(uint8_t phase) { return pgm_read_byte(&_phases[0][phase].slot); }
+
+    // Уровень фазы датчика при последнем измерении в разрядности resolution()
+    uint16_t level(uint8_t phase, uint8_t sensor = 0) {
+        return _levels[sensor][phase];
+    }
+    // Время установления сигнала фазы датчика при последнем измерении, мс
+    uint16_t settleTime(uint8_t phase, uint8_t sensor = 0) {
+        return _settle_times[sensor][phase];
+    }
+    // Сколько выборок набрано в фазе датчика при последнем измерении
+    uint16_t samplesUsed(uint8_t phase, uint8_t sensor = 0) {
+        return _used[sensor][phase];
+    }
+
+    // Сколько измерений прошёл датчик и среднее время от начала измерения
+    // до его последней фазы, мс (с прошлого resetStats())
+    uint16_t readings(uint8_t sensor) { return _readings[sensor]; }
+    uint16_t latency(uint8_t sensor) {
+        return _readings[sensor] ? _busy_ms[sensor] / _readings[sensor] : 0;
+    }
+    void resetStats() {
+        memset(_readings, 0, sizeof(_readings));
+        memset(_busy_ms, 0, sizeof(_busy_ms));
+    }
+
+  private:
+    enum HeadState : uint8_t { HeadIdle = 0, HeadLit, HeadDone };
+
+    static const uint8_t NO_HEAD = 0xFF;
+
+    // Среднее с округлением, масштабированное к _bits разрядам
+    uint16_t decimate(uint32_t sum, uint16_t count) {
+        if (!count)
+            return 0;
+        sum <<= _bits - ADC_RESOLUTION_BITS;
+        return (sum + count / 2) / count;
+    }
+
+    boolean confident() {
+        if (!_tolerance || adc_burstCount() < _next_check)
+            return false;
+        _next_check = adc_burstCount() + ACQUISITION_CHECK_SAMPLES;
+        return adc_burstConfident(0, _tolerance, _min_samples);
+    }
+
+    void enterPhase(uint8_t head) {
+        led_write(ledPin(_phase[head], head), _duty[head][_phase[head]]);
+        _lit_at[head] = millis();
+        _state[head] = HeadLit;
+    }
+
+    // Отдать АЦП датчику, которому он нужнее всего. false - всем ещё рано
+    boolean grant() {
+        uint32_t now = millis();
+        uint8_t best = NO_HEAD;
+        uint32_t best_deadline = 0;
+        for (uint8_t i = 1; i <= H; ++i) {
+            uint8_t h = (_last + i) % H;
+            if (_state[h] != HeadLit ||
+                now - _lit_at[h] < _settle.minDelay())
+                continue;
+            uint32_t deadline = _lit_at[h] + settleTimeout(_phase[h], h);
+            // Сравнение через разность со знаком переживает переполнение
+            if (best == NO_HEAD || (int32_t)(deadline - best_deadline) < 0) {
+                best = h;
+                best_deadline = deadline;
+            }
+        }
+        if (best == NO_HEAD)
+            return false;
+        _owner = _last = best;
+        adc_begin(_pins[best]);
+        _settle.setTimeout(settleTimeout(_phase[best], best));
+        _settle.start(_lit_at[best]);
+        return true;
+    }
+
+    const AcquisitionPhase (*_phases)[N];
+    const uint8_t *_pins;
+    SettleDetector &_settle;
+    HeadPolicy _policy = HeadsPipelined;
+    boolean _running = false, _reading = false;
+    uint8_t _owner = NO_HEAD, _last = H - 1, _end = N;
+    uint32_t _started = 0;
+    uint8_t _phase[H] = {};
+    HeadState _state[H] = {};
+    uint32_t _lit_at[H] = {};
+    uint16_t _ratio = 0;
+    uint8_t _bits = ADC_RESOLUTION_BITS;
+    uint8_t _tolerance = 0;
+    uint16_t _min_samples = 2, _next_check = 0;
+    uint16_t _used[H][N] = {};
+    uint8_t _duty[H][N];
+    uint16_t _levels[H][N] = {};
+    uint16_t _settle_times[H][N] = {};
+    uint16_t _readings[H] = {};
+    uint32_t _busy_ms[H] = {};
+};
+
+#endif
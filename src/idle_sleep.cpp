@@ -0,0 +1,77 @@
+#include "idle_sleep.hpp"
+
+#ifdef __AVR__
+#include <avr/sleep.h>
+#else
+#include "sim.h"
+#endif
+
+static uint32_t idle_started_ms = 0;
+static uint32_t idle_slept_ms = 0;
+static uint16_t idle_slept_us = 0;  // остаток меньше миллисекунды
+static uint32_t idle_sleep_count = 0, idle_early_count = 0;
+
+#ifdef __AVR__
+
+static void idle_cpu() {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    // Прерывание между проверкой wake() и sleep_cpu() просто будит на
+    // следующем тике Timer0, не позже чем через ~1 мс
+    sleep_enable();
+    sleep_cpu();
+    sleep_disable();
+}
+
+#else
+
+// millis() симулятора меняется ровно раз в 1000 мкс, а не на прерываниях
+// Timer0, поэтому спим до следующей смены millis()
+static void idle_cpu() {
+    delayMicroseconds(1000 - micros() % 1000);
+    sim_runScenario();
+}
+
+#endif
+
+bool idle_sleep(uint32_t ms, bool (*wake)()) {
+    uint32_t started_ms = millis();
+    uint32_t started_us = micros();
+    bool early = false;
+    idle_sleep_count++;
+    while (millis() - started_ms < ms) {
+        if (wake()) {
+            early = true;
+            break;
+        }
+        idle_cpu();
+    }
+    uint32_t slept_us = micros() - started_us + idle_slept_us;
+    idle_slept_ms += slept_us / 1000;
+    idle_slept_us = slept_us % 1000;
+    if (early)
+        idle_early_count++;
+    return early;
+}
+
+void idle_reset() {
+    idle_started_ms = millis();
+    idle_slept_ms = 0;
+    idle_slept_us = 0;
+    idle_sleep_count = 0;
+    idle_early_count = 0;
+}
+
+uint32_t idle_sleptMs() { return idle_slept_ms; }
+
+uint32_t idle_elapsedMs() { return millis() - idle_started_ms; }
+
+uint16_t idle_awakeX100() {
+    uint32_t elapsed = idle_elapsedMs();
+    if (!elapsed || idle_slept_ms >= elapsed)
+        return elapsed ? 0 : 10000;
+    return (uint64_t)(elapsed - idle_slept_ms) * 10000 / elapsed;
+}
+
+uint32_t idle_sleeps() { return idle_sleep_count; }
+
+uint32_t idle_earlyWakeups() { return idle_early_count; }
@@ -0,0 +1,31 @@
+#ifndef IDLE_SLEEP_HPP
+#define IDLE_SLEEP_HPP
+
+#include <Arduino.h>
+
+/*
+    Сон между событиями вместо холостых проходов loop().
+    - Процессор спит в SLEEP_MODE_IDLE: Timer0 (millis()), UART, TWI и
+      внешние прерывания продолжают работать, поэтому сроки планировщика
+      соблюдаются с точностью до миллисекунды
+    - Timer0 будит процессор каждые ~1 мс, после каждого пробуждения
+      вызывается проверка wake(): принятый байт, поворот энкодера или
+      нажатая кнопка прерывают сон сразу
+    - Учитывается время сна: доля времени без сна (скважность работы)
+      с прошлого idle_reset()
+    - Без AVR (сборка на ПК) сон - ожидание следующей смены millis() на
+      виртуальных часах, события сценария во сне продолжают приходить
+*/
+
+// Спать до ms миллисекунд. wake() проверяется после каждого пробуждения,
+// true - проснуться досрочно. Возвращает true при досрочном пробуждении
+bool idle_sleep(uint32_t ms, bool (*wake)());
+
+void idle_reset();              // начать учёт заново
+uint32_t idle_sleptMs();        // сколько проспали с прошлого idle_reset()
+uint32_t idle_elapsedMs();      // сколько прошло с прошлого idle_reset()
+uint16_t idle_awakeX100();      // доля времени без сна, % x100 (10000 - не спали)
+uint32_t idle_sleeps();         // количество засыпаний
+uint32_t idle_earlyWakeups();   // из них прерванных wake()
+
+#endif
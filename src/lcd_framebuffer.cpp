@@ -0,0 +1,187 @@
+#include "lcd_framebuffer.hpp"
+
+// Ячейка хранит символ, который выводится через CGRAM (не ASCII)
+static inline boolean isCustomGlyph(wchar_t c) { return c > 0x7E; }
+
+// Команда HD44780 "установить адрес DDRAM"
+static const uint8_t LCD_SET_DDRAM_ADDR = 0x80;
+// Адрес начала второй строки в DDRAM
+static const uint8_t LCD_ROW1_ADDR = 0x40;
+
+LcdFramebuffer::LcdFramebuffer(LCD_1602_RUS &lcd, uint8_t address)
+    : _lcd(lcd), _link(lcd, address) {
+    clear();
+    for (uint8_t i = 0; i < LCD_CELLS; ++i)
+        _shown[i] = ' ';
+}
+
+void LcdFramebuffer::clear() {
+    for (uint8_t i = 0; i < LCD_CELLS; ++i)
+        _wanted[i] = ' ';
+    home();
+}
+
+void LcdFramebuffer::home() { setCursor(0, 0); }
+
+void LcdFramebuffer::setCursor(uint8_t col, uint8_t row) {
+    _col = col;
+    _row = row < LCD_ROWS ? row : LCD_ROWS - 1;
+}
+
+uint8_t LcdFramebuffer::getCursorRow() { return _row; }
+
+void LcdFramebuffer::put(wchar_t c) {
+    // Как и у HD44780, вывод за край строки на следующую не переносится
+    if (_col < LCD_COLS)
+        _wanted[_row * LCD_COLS + _col] = c;
+    _col++;
+}
+
+void LcdFramebuffer::print(char c) { put((uint8_t)c); }
+
+void LcdFramebuffer::print(const char *str) {
+    while (*str)
+        put((uint8_t)*str++);
+}
+
+void LcdFramebuffer::print(const __FlashStringHelper *str) {
+    const char *p = reinterpret_cast<const char *>(str);
+    char c;
+    while ((c = pgm_read_byte(p++)) != 0)
+        put((uint8_t)c);
+}
+
+void LcdFramebuffer::print(const wchar_t *str) {
+    while (*str)
+        put(*str++);
+}
+
+void LcdFramebuffer::print(const LcdFlashText *str) {
+    wchar_t c;
+    for (uint8_t i = 0; (c = lcd_flashChar(str, i)) != 0; ++i)
+        put(c);
+}
+
+boolean LcdFramebuffer::isDirty() {
+    if (_full_redraw)
+        return true;
+    for (uint8_t i = 0; i < LCD_CELLS; ++i)
+        if (_wanted[i] != _shown[i])
+            return true;
+    return false;
+}
+
+void LcdFramebuffer::invalidate() { _full_redraw = true; }
+
+boolean LcdFramebuffer::glyphsChanged() {
+    for (uint8_t i = 0; i < LCD_CELLS; ++i)
+        if (_wanted[i] != _shown[i] &&
+            (isCustomGlyph(_wanted[i]) || isCustomGlyph(_shown[i])))
+            return true;
+    return false;
+}
+
+void LcdFramebuffer::moveLcdCursor(uint8_t cell) {
+    if (_lcd_cursor == cell)
+        return;
+    _lcd.setCursor(cell % LCD_COLS, cell / LCD_COLS);
+    _command_bytes++;
+    _lcd_cursor = cell;
+}
+
+void LcdFramebuffer::redrawAll() {
+    _lcd.clear();
+    _command_bytes++;
+    _lcd_cursor = 0;
+    for (uint8_t row = 0; row < LCD_ROWS; ++row) {
+        uint8_t first = row * LCD_COLS, last = first + LCD_COLS;
+        while (first < last && _wanted[first] == ' ')
+            first++;
+        while (last > first && _wanted[last - 1] == ' ')
+            last--;
+        if (first == last)
+            continue;
+        // Одна строка - один вызов, чтобы LCD_1602_RUS сам разместил
+        // кириллицу в CGRAM
+        wchar_t run[LCD_COLS + 1];
+        uint8_t length = 0;
+        for (uint8_t i = first; i < last; ++i)
+            run[length++] = _wanted[i];
+        run[length] = 0;
+        moveLcdCursor(first);
+        _lcd.print(run);
+        _data_bytes += length;
+        _lcd_cursor = last % LCD_COLS ? last : LCD_CELLS;
+    }
+    for (uint8_t i = 0; i < LCD_CELLS; ++i)
+        _shown[i] = _wanted[i];
+    _full_redraw = false;
+}
+
+void LcdFramebuffer::update() {
+    if (_full_redraw || glyphsChanged()) {
+        redrawAll();
+        return;
+    }
+    for (uint8_t i = 0; i < LCD_CELLS; ++i) {
+        if (_wanted[i] == _shown[i])
+            continue;
+        moveLcdCursor(i);
+        _lcd.write((uint8_t)_wanted[i]);
+        _data_bytes++;
+        _shown[i] = _wanted[i];
+        // После последней ячейки строки адрес HD44780 уходит за экран
+        _lcd_cursor = (i + 1) % LCD_COLS ? i + 1 : LCD_CELLS;
+    }
+}
+
+void LcdFramebuffer::setRefreshRate(uint8_t hz) {
+    _refresh_period = hz ? 1000 / hz : 0;
+}
+
+void LcdFramebuffer::moveLinkCursor(uint8_t cell) {
+    if (_lcd_cursor == cell)
+        return;
+    uint8_t row = cell / LCD_COLS;
+    _link.command(LCD_SET_DDRAM_ADDR | (row ? LCD_ROW1_ADDR : 0) |
+                  (cell % LCD_COLS));
+    _command_bytes++;
+    _lcd_cursor = cell;
+}
+
+void LcdFramebuffer::poll() {
+    if (!_link.isIdle())
+        return;
+    if (!_refreshing) {
+        if (millis() - _refresh_started < _refresh_period || !isDirty())
+            return;
+        _refreshing = true;
+        _refresh_started = millis();
+    }
+    if (_full_redraw || glyphsChanged()) {
+        redrawAll();
+        _refreshing = false;
+        return;
+    }
+    // Одна посылка: перенос курсора и символ занимают по одному месту
+    for (uint8_t i = 0; i < LCD_CELLS; ++i) {
+        if (_wanted[i] == _shown[i])
+            continue;
+        if (_link.isFull())
+            break;
+        moveLinkCursor(i);
+        if (_link.isFull())
+            break;
+        _link.data((uint8_t)_wanted[i]);
+        _data_bytes++;
+        _shown[i] = _wanted[i];
+        _lcd_cursor = (i + 1) % LCD_COLS ? i + 1 : LCD_CELLS;
+    }
+    _link.send();
+    if (!isDirty())
+        _refreshing = false;
+}
+
+uint32_t LcdFramebuffer::dataBytes() { return _data_bytes; }
+
+uint32_t LcdFramebuffer::commandBytes() { return _command_bytes; }
@@ -0,0 +1,88 @@
+#ifndef LCD_FRAMEBUFFER_HPP
+#define LCD_FRAMEBUFFER_HPP
+
+#include <Arduino.h>
+#include <LCD_1602_RUS.h>
+
+#include "lcd_link.hpp"
+
+/*
+    Теневой буфер экрана 16x2.
+    - Все функции вывода пишут только в буфер в памяти, экран не трогают
+    - update() сравнивает буфер с тем, что уже показано, и отправляет по I2C
+      только изменившиеся ячейки, переставляя курсор лишь при разрывах
+    - Символы кириллицы LCD_1602_RUS выводит через 8 пользовательских
+      символов CGRAM, которые освобождаются только при очистке экрана.
+      Поэтому если меняется хотя бы одна ячейка с кириллицей, экран
+      очищается и перерисовывается целиком (это бывает только при смене
+      режима), а обычные показания (#RRGGBB) обновляются по ячейкам
+    - poll() делает то же, что update(), но не блокирует loop(): изменения
+      уходят небольшими посылками через LcdLink по прерыванию TWI, а новый
+      проход обновления начинается не чаще заданной частоты обновления.
+      Полная перерисовка и в этом случае идёт через библиотеку и блокирует
+*/
+
+const uint8_t LCD_COLS = 16;
+const uint8_t LCD_ROWS = 2;
+const uint8_t LCD_CELLS = LCD_COLS * LCD_ROWS;
+
+// Строка широких символов во флеш-памяти: LF(L"Текст"), как F() для char.
+// Строка L"" без него целиком копируется в ОЗУ, по 2 байта на символ
+class LcdFlashText;
+#define LF(string_literal)                                        \
+    (reinterpret_cast<const LcdFlashText *>(__extension__({      \
+        static const wchar_t __c[] PROGMEM = (string_literal);   \
+        &__c[0];                                                  \
+    })))
+
+// i-й символ строки из LF()
+inline wchar_t lcd_flashChar(const LcdFlashText *str, uint8_t i) {
+    const wchar_t *p = reinterpret_cast<const wchar_t *>(str) + i;
+    return sizeof(wchar_t) == 2 ? pgm_read_word(p) : pgm_read_dword(p);
+}
+
+class LcdFramebuffer {
+  public:
+    LcdFramebuffer(LCD_1602_RUS &lcd, uint8_t address);
+
+    void clear();                               // очистить буфер, курсор в начало
+    void home();                                // курсор в начало
+    void setCursor(uint8_t col, uint8_t row);   // установить курсор буфера
+    uint8_t getCursorRow();                     // текущая строка курсора буфера
+
+    void print(char c);
+    void print(const char *str);
+    void print(const __FlashStringHelper *str);
+    void print(const wchar_t *str);
+    void print(const LcdFlashText *str);
+
+    boolean isDirty();      // есть ли в буфере не показанные изменения
+    void update();          // отправить изменения на экран (с ожиданием)
+    void poll();            // отправить часть изменений в фоне, звать из loop()
+    void setRefreshRate(uint8_t hz);  // не чаще hz проходов обновления в секунду
+    void invalidate();      // содержимое экрана неизвестно, перерисовать целиком
+
+    uint32_t dataBytes();       // сколько символов отправлено на экран
+    uint32_t commandBytes();    // сколько команд (курсор, очистка) отправлено
+
+  private:
+    void put(wchar_t c);
+    boolean glyphsChanged();
+    void redrawAll();
+    void moveLcdCursor(uint8_t cell);
+    void moveLinkCursor(uint8_t cell);
+
+    LCD_1602_RUS &_lcd;
+    LcdLink _link;
+    wchar_t _wanted[LCD_CELLS];
+    wchar_t _shown[LCD_CELLS];
+    uint8_t _col = 0, _row = 0;
+    uint8_t _lcd_cursor = LCD_CELLS;  // LCD_CELLS - положение неизвестно
+    boolean _full_redraw = true;
+    boolean _refreshing = false;
+    uint16_t _refresh_period = 0;
+    uint32_t _refresh_started = 0;
+    uint32_t _data_bytes = 0, _command_bytes = 0;
+};
+
+#endif
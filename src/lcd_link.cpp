@@ -0,0 +1,55 @@
+#include "lcd_link.hpp"
+
+#ifdef __AVR__
+extern "C" {
+#include <utility/twi.h>
+}
+#endif
+
+// Выводы PCF8574 на стандартном переходнике
+static const uint8_t PCF_RS = 0x01;
+static const uint8_t PCF_EN = 0x04;
+static const uint8_t PCF_BACKLIGHT = 0x08;
+
+LcdLink::LcdLink(LCD_1602_RUS &lcd, uint8_t address)
+    : _lcd(lcd), _address(address), _backlight(PCF_BACKLIGHT) {}
+
+void LcdLink::setBacklight(boolean on) { _backlight = on ? PCF_BACKLIGHT : 0; }
+
+boolean LcdLink::isIdle() { return micros() - _busy_since >= _busy_us; }
+
+boolean LcdLink::isFull() { return _length >= sizeof(_buffer); }
+
+void LcdLink::put(uint8_t value, uint8_t mode) {
+#ifdef __AVR__
+    if (isFull())
+        return;
+    uint8_t high = (value & 0xF0) | mode | _backlight;
+    uint8_t low = (value << 4) | mode | _backlight;
+    _buffer[_length++] = high | PCF_EN;
+    _buffer[_length++] = high;
+    _buffer[_length++] = low | PCF_EN;
+    _buffer[_length++] = low;
+#else
+    if (mode)
+        _lcd.write(value);
+    else
+        _lcd.command(value);
+#endif
+}
+
+void LcdLink::command(uint8_t value) { put(value, 0); }
+
+void LcdLink::data(uint8_t value) { put(value, PCF_RS); }
+
+void LcdLink::send() {
+#ifdef __AVR__
+    if (!_length)
+        return;
+    twi_writeTo(_address, _buffer, _length, 0, 1);
+    // Адрес + байты по 9 тактов, с запасом на START/STOP
+    _busy_us = (uint32_t)(_length + 2) * 9 * 1000000UL / LCD_TWI_FREQ;
+    _busy_since = micros();
+    _length = 0;
+#endif
+}
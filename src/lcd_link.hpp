@@ -0,0 +1,46 @@
+#ifndef LCD_LINK_HPP
+#define LCD_LINK_HPP
+
+#include <Arduino.h>
+#include <LCD_1602_RUS.h>
+
+/*
+    Неблокирующая передача байтов HD44780 через переходник PCF8574.
+    - Каждый байт экрана превращается в 4 байта для PCF8574 (две тетрады,
+      каждая с импульсом EN), до LCD_LINK_CHUNK байтов экрана собираются в
+      одну посылку I2C
+    - Посылка отдаётся twi_writeTo() из ядра Arduino без ожидания: дальше
+      её передаёт прерывание TWI, а loop() продолжает работать
+    - Состояние автомата TWI в ядре не видно снаружи, поэтому время
+      окончания посылки оценивается по её длине и частоте шины
+    - Без AVR байты отправляются через библиотеку экрана синхронно
+*/
+
+// Частота шины I2C (Wire по умолчанию)
+const uint32_t LCD_TWI_FREQ = 100000;
+// Байтов экрана в одной посылке: буфер TWI ядра - 32 байта
+const uint8_t LCD_LINK_CHUNK = 8;
+
+class LcdLink {
+  public:
+    LcdLink(LCD_1602_RUS &lcd, uint8_t address);
+
+    void setBacklight(boolean on);
+    boolean isIdle();                   // предыдущая посылка передана
+    boolean isFull();                   // посылка набрана целиком
+    void command(uint8_t value);        // добавить команду в посылку
+    void data(uint8_t value);           // добавить символ в посылку
+    void send();                        // начать передачу посылки
+
+  private:
+    void put(uint8_t value, uint8_t mode);
+
+    LCD_1602_RUS &_lcd;
+    uint8_t _address;
+    uint8_t _backlight;
+    uint8_t _buffer[LCD_LINK_CHUNK * 4];
+    uint8_t _length = 0;
+    uint32_t _busy_since = 0, _busy_us = 0;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include "led_pwm.hpp"
+
+#ifdef __AVR__
+
+#include <avr/interrupt.h>
+
+// Пины программного ШИМ: регистр порта и маска
+static struct {
+    uint8_t pin;
+    volatile uint8_t *port;
+    uint8_t mask;
+} led_soft[LED_SOFT_PWM_PINS];
+static uint8_t led_soft_count = 0;
+// Пины (биты - номера в led_soft), горящие сейчас по ШИМ
+static volatile uint8_t led_soft_lit = 0;
+// Таймер после BOTTOM считает вверх: следующее совпадение - конец импульса
+static volatile bool led_soft_rising = true;
+
+static void led_softSet(bool on) {
+    for (uint8_t i = 0; i < led_soft_count; ++i) {
+        if (!(led_soft_lit & _BV(i)))
+            continue;
+        if (on)
+            *led_soft[i].port |= led_soft[i].mask;
+        else
+            *led_soft[i].port &= ~led_soft[i].mask;
+    }
+}
+
+ISR(TIMER2_OVF_vect) { led_soft_rising = true; }
+
+ISR(TIMER2_COMPB_vect) {
+    led_softSet(!led_soft_rising);
+    led_soft_rising = false;
+}
+
+void led_begin(uint8_t pin) {
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+    if (digitalPinToTimer(pin) != NOT_ON_TIMER ||
+        led_soft_count >= LED_SOFT_PWM_PINS)
+        return;
+    for (uint8_t i = 0; i < led_soft_count; ++i)
+        if (led_soft[i].pin == pin)
+            return;
+    led_soft[led_soft_count].pin = pin;
+    led_soft[led_soft_count].port = portOutputRegister(digitalPinToPort(pin));
+    led_soft[led_soft_count].mask = digitalPinToBitMask(pin);
+    led_soft_count++;
+}
+
+void led_write(uint8_t pin, uint8_t duty) {
+    if (digitalPinToTimer(pin) != NOT_ON_TIMER) {
+        analogWrite(pin, duty);
+        return;
+    }
+    uint8_t bit = 0;
+    for (uint8_t i = 0; i < led_soft_count; ++i)
+        if (led_soft[i].pin == pin)
+            bit = _BV(i);
+    noInterrupts();
+    if (!bit || duty == 0 || duty == 255) {
+        // Без ШИМ: пин не зарегистрирован (горит при любой скважности
+        // кроме 0) или скважность крайняя
+        led_soft_lit &= ~bit;
+        digitalWrite(pin, duty ? HIGH : LOW);
+    } else {
+        OCR2B = duty;
+        led_soft_lit |= bit;
+    }
+    if (led_soft_lit)
+        TIMSK2 |= _BV(OCIE2B) | _BV(TOIE2);
+    else
+        TIMSK2 &= ~(_BV(OCIE2B) | _BV(TOIE2));
+    interrupts();
+}
+
+#else
+
+// Модель фоторезистора симулятора берёт среднюю яркость, заглушка
+// analogWrite() запоминает её на любом пине
+void led_begin(uint8_t pin) {
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+}
+
+void led_write(uint8_t pin, uint8_t duty) { analogWrite(pin, duty); }
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef LED_PWM_HPP
+#define LED_PWM_HPP
+
+#include <Arduino.h>
+
+/*
+    Яркость светодиодов подсветки (скважность 0-255).
+    - На пинах с аппаратным ШИМ - analogWrite()
+    - На остальных - программный ШИМ на прерываниях Timer2, который ядро
+      уже держит в режиме phase correct с делителем 64 (~490 Гц): импульс
+      включается на совпадении с OCR2B при счёте вниз и выключается при
+      счёте вверх, то есть длится OCR2B / 255 периода. Вывод OC2B (пин 3)
+      остаётся отключённым от таймера, энкодер на нём не мешает
+    - Программный ШИМ один на все такие пины: одновременно горящие
+      получают одну скважность (последнюю заданную). В таблицах фаз
+      одновременно горит не больше одного светодиода без таймера
+    - Скважность 0 и 255 - обычный digitalWrite(), прерывания выключены
+    - Фоторезистор с постоянной времени в десятки мс сглаживает ШИМ,
+      уровень АЦП пропорционален средней яркости
+*/
+
+// Наибольшее количество пинов на программном ШИМ
+const uint8_t LED_SOFT_PWM_PINS = 4;
+
+void led_begin(uint8_t pin);                 // pinMode(OUTPUT), светодиод выключен
+void led_write(uint8_t pin, uint8_t duty);   // 0 - выключен, 255 - полностью включён
+
+#endif
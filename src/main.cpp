@@ -1,39 +1,39 @@
 #include "main.hpp"
 
 #if ENABLE_SERIAL_DEBUG == 0
-#define debug(s)
+#define debug(...)
 #else
-inline void debug(String message) { Serial.println(message); }
-#endif
-
-#define _(s) String(s)
+inline void debug_print() { Serial.println(); }
 
-String toHex(uint8_t w) {
-    String hex = String(w, HEX);
-    hex.toUpperCase();
-    return (w > 15) ? hex : "0" + hex;
+template <typename T, typename... Rest>
+void debug_print(const T &first, const Rest &... rest) {
+    // Отладочный вывод не должен попасть внутрь пакета измерений
+    serial_batch.flush();
+    Serial.print(first);
+    debug_print(rest...);
 }
 
-void enable_led(Color color) { digitalWrite(ledPins[color], 1); }
-
-void disable_led(Color color) { digitalWrite(ledPins[color], 0); }
+#define debug(...) debug_print(__VA_ARGS__)
+#endif
 
-void switchAllLeds(bool state = LOW) {
-    for (uint8_t ledPin : ledPins)
-        digitalWrite(ledPin, state);
+void lcd_printCenter(const char *_str, uint8_t row = screen.getCursorRow()) {
+    screen.setCursor((LCD_COLS - strlen(_str)) / 2, row);
+    screen.print(_str);
 }
 
-void lcd_printCenter(String _str, uint8_t row = lcd.getCursorRow()) {
-    lcd.setCursor((16 - (_str.length())) / 2, row);
-    lcd.print(_str);
+void lcd_printCenter(const LcdFlashText *_str,
+                     uint8_t row = screen.getCursorRow()) {
+    uint8_t size = 0;
+    while (lcd_flashChar(_str, size) != 0)
+        size++;
+    screen.setCursor((LCD_COLS - size) / 2, row);
+    screen.print(_str);
 }
 
-void lcd_printCenter(const wchar_t *_str, uint8_t row = lcd.getCursorRow()) {
-    uint8_t size = 0;
-    while (_str[size++] != 0)
-        ;
-    lcd.setCursor((16 - (--size)) / 2, row);
-    lcd.print(_str);
+void lcd_clearRow(uint8_t row) {
+    screen.setCursor(0, row);
+    for (uint8_t i = 0; i < LCD_COLS; ++i)
+        screen.print(' ');
 }
 
 void lcd_init() {
@@ -41,99 +41,264 @@ void lcd_init() {
     lcd.init();
     lcd.clear();
     lcd.backlight();
+    screen.setRefreshRate(LCD_REFRESH_RATE);
 }
 
 void lcd_displayLoadingScreen() {
     debug(F("Showing loading screen..."));
-    lcd_printCenter(L"ДАТЧИК ЦВЕТА");
-    lcd.setCursor(0, 1);
-    lcd_printCenter(L"Загрузка...");
+    lcd_printCenter(LF(L"ДАТЧИК ЦВЕТА"));
+    screen.setCursor(0, 1);
+    lcd_printCenter(LF(L"Загрузка..."));
+    screen.update();
+}
+
+// Данные первого датчика лежат там же, где до поддержки нескольких
+// датчиков, так что прежняя калибровка сохраняется
+int calibrationAddress(uint8_t sensor) {
+    return EEPROM_CALIBRATION_ADDRESS +
+           sensor * (sizeof(rgbMin[0]) + sizeof(rgbMax[0]));
 }
 
 void writeCalibrationData() {
-    for (uint8_t i = 0; i < 3; ++i) {
-        EEPROM.update(i, rgbMin[i]);
-        EEPROM.update(i + 3, rgbMax[i]);
+    for (uint8_t s = 0; s < SENSOR_COUNT; ++s) {
+        EEPROM.put(calibrationAddress(s), rgbMin[s]);
+        EEPROM.put(calibrationAddress(s) + sizeof(rgbMin[s]), rgbMax[s]);
+    }
+}
+
+// Возвращает false, если в EEPROM нет корректных данных датчика
+// (например, после прошивки там 0xFF), тогда берётся весь диапазон АЦП
+bool readCalibrationData(uint8_t sensor) {
+    uint16_t white[ACQUISITION_CHANNELS], black[ACQUISITION_CHANNELS];
+    EEPROM.get(calibrationAddress(sensor), white);
+    EEPROM.get(calibrationAddress(sensor) + sizeof(white), black);
+    bool valid = true;
+    for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i)
+        if (white[i] >= black[i] || black[i] > 1023)
+            valid = false;
+    for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i) {
+        rgbMin[sensor][i] = valid ? white[i] : 0;
+        rgbMax[sensor][i] = valid ? black[i] : 1023;
     }
+    return valid;
 }
 
-void readColorLevel(Color color) {
-    read_repeats_left--;
-    debug("Reading #" + String(CONSECUTIVE_READINGS_COUNT - read_repeats_left));
-    uint16_t c = analogRead(SENSOR_PIN);
-    debug("Current reading: " + String(c));
-    level_sum += c;
+// Пересчитать таблицы датчика по rgbMin и rgbMax. Без калибровки шкала
+// линейная: модель фоторезистора без опорных уровней ничего не даёт
+void buildTransfer(uint8_t sensor, bool linearise) {
+    for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i)
+        transfer[sensor][i].build(rgbMin[sensor][i], rgbMax[sensor][i],
+                                  linearise ? LDR_GAMMA : 0);
 }
 
-uint8_t adjustColorLevel(Color color, uint16_t raw_level) {
-    debug("Raw: " + String(raw_level));
-    raw_level = constrain(raw_level, rgbMin[color], rgbMax[color]);
-    debug("Raw-C: " + String(raw_level));
-    raw_level = map(raw_level, rgbMin[color], rgbMax[color], 255, 0);
-    debug("Raw-Mapped: " + String(raw_level));
-    return raw_level;
+// Уровень в исходной разрядности АЦП (0-1023)
+uint16_t levelTo10Bit(uint16_t level) {
+    return level >> (sequencer.resolution() - ADC_RESOLUTION_BITS);
 }
 
-void sendColorToSerial(uint8_t r, uint8_t g, uint8_t b) {
-    Serial.println(SERIAL_MESSAGE_START + String(r) +
-                   SERIAL_MESSAGE_VALUES_SEP + String(g) +
-                   SERIAL_MESSAGE_VALUES_SEP + String(b) + SERIAL_MESSAGE_END);
+uint8_t adjustColorLevel(uint8_t sensor, uint8_t slot, uint16_t raw_level) {
+    uint8_t duty = current_duty[sensor][slot];
+    uint8_t value = transfer[sensor][slot].apply(raw_level, duty);
+    debug(F("Raw: "), raw_level, F(" at duty "), duty, F(", mapped: "),
+          value);
+    return value;
+}
+
+// Скважность, при которой уровень level (10 бит), снятый при скважности
+// duty, станет целевым. Таблица передаточной функции уже линейна по свету
+// (модель фоторезистора с LDR_GAMMA), а свет пропорционален скважности,
+// поэтому скважность умножается на отношение яркостей цели и уровня.
+// Фон не учитывается, а уровни светлее белого образца упираются в
+// яркость 255, поэтому к цели уровень подходит за 1-3 измерения. Без
+// калибровки яркость пересчитать к полной нельзя (шкала не по свету),
+// светодиоды горят в полную силу
+uint8_t rangedDuty(uint8_t sensor, uint8_t slot, uint8_t duty,
+                   uint16_t level) {
+    const ColorTransfer &channel = transfer[sensor][slot];
+    if (!led_ranging_target || !channel.isLinearised())
+        return 255;
+    if (abs((int16_t)level - (int16_t)led_ranging_target) <=
+        (int16_t)LED_RANGING_TOLERANCE)
+        return duty;
+    uint16_t light = channel.interpolate(level);
+    if (!light)
+        return 255;
+    uint32_t ranged =
+        ((uint32_t)duty * channel.interpolate(led_ranging_target) +
+         light / 2) /
+        light;
+    return constrain(ranged, LED_MIN_DUTY, 255);
+}
+
+// Подстроить яркость светодиодов к следующему измерению. Общий светодиод
+// настраивается по самому освещённому датчику
+void updateLedRanging() {
+    for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i) {
+        uint8_t slot = sequencer.slot(i);
+        uint8_t shared = 255;
+        for (uint8_t s = 0; s < SENSOR_COUNT; ++s) {
+            uint8_t duty = rangedDuty(s, slot, current_duty[s][slot],
+                                      levelTo10Bit(current_levels[s][slot]));
+            if (sequencer.sharedLeds())
+                shared = min(shared, duty);
+            else
+                sequencer.setDuty(i, duty, s);
+        }
+        if (sequencer.sharedLeds())
+            sequencer.setDuty(i, shared);
+    }
+}
+
+// Светодиоды в полную силу: для калибровки и после выключения подстройки
+void resetLedRanging() {
+    for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i)
+        for (uint8_t s = 0; s < SENSOR_COUNT; ++s)
+            sequencer.setDuty(i, 255, s);
+}
+
+void sendColorToSerial(uint8_t sensor, uint8_t r, uint8_t g, uint8_t b) {
+    if (serial_format == BinaryRawFormat) {
+        // В кадре помещаются три 10-битных уровня: только цветные фазы,
+        // остальные - в формате уровней
+        uint16_t levels[3];
+        for (uint8_t i = 0; i < 3; ++i)
+            levels[i] = levelTo10Bit(current_levels[sensor][i]);
+        serial_batch.flush();
+        frame_sendRawLevels(Serial, currentMode, levels, sensor);
+        return;
+    }
+    if (serial_format == BinaryLevelsFormat) {
+        serial_batch.flush();
+        for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i) {
+            frame_sendLevel(Serial, currentMode, i, sequencer.resolution(),
+                            current_levels[sensor][i], sensor);
+            frame_sendSamples(Serial, currentMode, i,
+                              current_samples[sensor][i], sensor);
+        }
+        return;
+    }
+    // Цвета идут через очередь пакетов: при размере пакета 1 вывод тот же,
+    // что и без неё ($#$R,G,B@!@ или кадр цвета)
+    int16_t components[3];
+    color_convert(serial_space, r, g, b, components);
+    char tag = serial_space == SpaceRgb
+                   ? 0
+                   : (char)pgm_read_byte(&SERIAL_SPACE_TAGS[serial_space]);
+    serial_batch.setFormat(serial_format == BinaryFormat, currentMode,
+                           serial_space, tag);
+    serial_batch.push(components, sensor);
+}
+
+// Обозначение режима в текстовых пакетах и в отчёте о состоянии
+const __FlashStringHelper *modeName(Mode mode) {
+    return mode == RunningAuto     ? F("AM")
+           : mode == RunningManual ? F("MM")
+           : mode == Calibrating   ? F("CM")
+                                   : F("PM");
+}
+
+void sendModeToSerial(Mode mode) {
+    serial_batch.flush();
+    if (serial_format != TextFormat) {
+        frame_sendMode(Serial, mode);
+        return;
+    }
+    Serial.print(FLASH_STR(SERIAL_MESSAGE_START));
+    Serial.print(modeName(mode));
+    Serial.println(FLASH_STR(SERIAL_MESSAGE_END));
 }
 
 void sendColorToLCD(uint8_t r, uint8_t g, uint8_t b) {
-    lcd_printCenter("#" + toHex(r) + toHex(g) + toHex(b), 1);
+    lcd_clearRow(1);
+    if (lcd_space == SpaceRgb) {
+        TextBuffer<LCD_COLS> text;
+        text.add('#').addHex(r).addHex(g).addHex(b);
+#if ENABLE_COLOR_NAMES
+        // "#RRGGBB firebric": current_lab уже посчитан в readColor()
+        uint16_t distance;
+        char name[COLOR_NAME_LENGTH + 1];
+        colornames_name(colornames_find(current_lab, distance), name);
+        text.add(' ').add(name);
+        debug(F("Nearest named color: "), name, F(", dE x100 "), distance);
+#endif
+        lcd_printCenter(text.c_str(), 1);
+        return;
+    }
+    // "H359 S255 V255", "X95 Y100 Z109", "L53 a-80 b67"
+    int16_t components[3];
+    color_convert(lcd_space, r, g, b, components);
+    uint8_t divider = pgm_read_byte(&LCD_SPACE_DIVIDERS[lcd_space - 1]);
+    const char *letters = LCD_SPACE_LETTERS + (lcd_space - 1) * 3;
+    TextBuffer<LCD_COLS> text;
+    for (uint8_t i = 0; i < 3; ++i) {
+        int16_t value = components[i];
+        value = (value + (value < 0 ? -divider / 2 : divider / 2)) / divider;
+        if (i)
+            text.add(' ');
+        text.add((char)pgm_read_byte(&letters[i])).addInt(value);
+    }
+    lcd_printCenter(text.c_str(), 1);
 }
 
-void displayColor(uint8_t r, uint8_t g, uint8_t b) {
-    sendColorToSerial(r, g, b);
-    sendColorToLCD(r, g, b);
+// В Serial идут все датчики (если serial), на экран - первый
+void displayColor(bool serial) {
+    for (uint8_t s = 0; s < SENSOR_COUNT && serial; ++s)
+        sendColorToSerial(s, current_rgb[s][Red], current_rgb[s][Green],
+                          current_rgb[s][Blue]);
+    sendColorToLCD(current_rgb[0][Red], current_rgb[0][Green],
+                   current_rgb[0][Blue]);
 }
 
 void printModeInfo() {
     if (!refreshScreen)
         return;
     refreshScreen = false;
-    lcd.home();
-    lcd.print(currentMode == RunningAuto
-                  ? "A"
-                  : currentMode == RunningManual ? "P" : "");
+    screen.home();
+    screen.print(currentMode == RunningAuto
+                  ? F("A")
+                  : currentMode == RunningManual ? F("P") : F(""));
     lcd_printCenter(currentMode == RunningAuto || currentMode == RunningManual
-                        ? L"Цвет (RGB):"
-                        : L"Пауза",
+                        ? LF(L"Цвет (RGB):")
+                        : LF(L"Пауза"),
                     0);
 
-    lcd.setCursor(0, 1);
+    screen.setCursor(0, 1);
 }
 
+// Задача планировщика: подошёл срок следующего измерения
+void autoReadingDue() { auto_reading_due = true; }
+
 void switchToAuto() {
     refreshScreen = true;
     debug(F("Entering AUTO mode..."));
-    reading_state = NotStarted;
+    sequencer.cancel();
+    manual_state = Idle;
     currentMode = Mode::RunningAuto;
-    lcd.clear();
-    lcd.print("A");
-    lcd_printCenter(L"Считываем", 0);
-    lcd_printCenter(L"цвет...", 1);
+    screen.clear();
+    screen.print(F("A"));
+    lcd_printCenter(LF(L"Считываем"), 0);
+    lcd_printCenter(LF(L"цвет..."), 1);
     debug(F("The device is now in AUTO mode."));
-    Serial.println(SERIAL_MESSAGE_START + "AM" + SERIAL_MESSAGE_END);
-    next_iteration_timer.start();
-    multiple_readings_timer.start();
-    color_switch_timer.start();
+    sendModeToSerial(RunningAuto);
+    // Первое измерение сразу после переключения, полное и отправляется
+    // в любом случае
+    scheduler.cancel(autoReadingDue);
+    auto_reading_due = true;
+    auto_state = AutoFull;
+    lab_reported = false;
 }
 
 void switchToManual() {
     refreshScreen = true;
     debug(F("Entering MANUAL mode..."));
-    switchAllLeds();
-    reading_state = NotStarted;
+    sequencer.cancel();
+    manual_state = Idle;
     currentMode = Mode::RunningManual;
-    lcd.clear();
-    lcd.print("P");
-    lcd_printCenter(L"Готов!", 0);
+    screen.clear();
+    screen.print(F("P"));
+    lcd_printCenter(LF(L"Ручной режим"), 0);
     debug(F("The device is now in MANUAL mode."));
-    Serial.println(SERIAL_MESSAGE_START + "MM" + SERIAL_MESSAGE_END);
-    multiple_readings_timer.start();
-    color_switch_timer.start();
+    sendModeToSerial(RunningManual);
 }
 
 void pause() {
@@ -152,202 +317,791 @@ void pause() {
         return;
     }
     debug(F("Entering PAUSED mode..."));
-    switchAllLeds();
-    reading_state = NotStarted;
+    sequencer.cancel();
+    manual_state = Idle;
     modeBeforePause = currentMode;
     currentMode = Mode::Paused;
-    lcd.clear();
-    lcd.print(L"П");
-    lcd_printCenter(L"ПАУЗА", 0);
+    screen.clear();
+    screen.print(LF(L"П"));
+    lcd_printCenter(LF(L"ПАУЗА"), 0);
     debug(F("The device is now in PAUSED mode."));
-    Serial.println(SERIAL_MESSAGE_START + "PM" + SERIAL_MESSAGE_END);
+    sendModeToSerial(Paused);
+}
+
+// Продвинуть измерение count фаз от first, при необходимости начав его.
+// Возвращает true, когда оно закончено
+bool tickAcquisition(uint8_t first, uint8_t count) {
+    if (!sequencer.isRunning()) {
+        debug(F("Starting color acquisition, phases "), first, F("-"),
+              first + count - 1);
+        sequencer.start(first, count);
+        return false;
+    }
+#if ENABLE_PROFILER
+    uint8_t profile_slot =
+        sequencer.isWaiting() ? ProfileWaiting : ProfileReading;
+#endif
+    PROFILE_BEGIN(tick);
+    bool done = sequencer.tick();
+    PROFILE_END(tick, profile_slot);
+    return done;
+}
+
+// Продвинуть измерение уровней всеми светодиодами, при необходимости
+// начав новое. Возвращает true, когда current_levels обновлены
+bool acquireLevels() {
+    if (!tickAcquisition(0, ACQUISITION_CHANNELS))
+        return false;
+    for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i) {
+        uint8_t slot = sequencer.slot(i);
+        for (uint8_t s = 0; s < SENSOR_COUNT; ++s) {
+            current_levels[s][slot] = sequencer.level(i, s);
+            current_duty[s][slot] = sequencer.duty(i, s);
+            current_samples[s][slot] = sequencer.samplesUsed(i, s);
+        }
+        debug(F("Phase "), i, F(": level "), current_levels[0][slot],
+              F(", settled in "), sequencer.settleTime(i), F(" ms"));
+    }
+    debug(F("ADC overruns: "), adc_overruns());
+    return true;
+}
+
+// Пробное измерение фазы probe_phase. Возвращает true, когда оно
+// закончено; changed - значение цвета этой фазы хотя бы у одного датчика
+// отошло от последнего полного измерения больше чем на порог. Уровень
+// пересчитывается к полной яркости, так что скважность пробы может
+// отличаться от скважности полного измерения
+bool probeColor(bool &changed) {
+    if (!tickAcquisition(probe_phase, 1))
+        return false;
+    uint8_t slot = sequencer.slot(probe_phase);
+    changed = false;
+    for (uint8_t s = 0; s < SENSOR_COUNT; ++s) {
+        uint8_t value = transfer[s][slot].apply(
+            levelTo10Bit(sequencer.level(probe_phase, s)),
+            sequencer.duty(probe_phase, s));
+        if (abs((int16_t)value - current_rgb[s][slot]) > trigger_threshold)
+            changed = true;
+        debug(F("Probe "), s, F(": phase "), probe_phase, F(", value "),
+              value, F(" was "), current_rgb[s][slot]);
+    }
+    probe_phase = (probe_phase + 1) % ACQUISITION_CHANNELS;
+    auto_probes++;
+    return true;
+}
+
+// Отправлять ли измерение в Serial. В автоматическом режиме с порогом
+// дельты E - только если цвет хотя бы одного датчика сдвинулся от
+// последнего отправленного больше чем на порог
+bool colorMoved() {
+    if (currentMode != RunningAuto)
+        return true;
+    auto_readings++;
+    bool moved = !report_delta_e || !lab_reported;
+    if (report_delta_e) {
+        ColorLab lab[SENSOR_COUNT];
+        for (uint8_t s = 0; s < SENSOR_COUNT; ++s) {
+            color_toLab(current_rgb[s][Red], current_rgb[s][Green],
+                        current_rgb[s][Blue], lab[s]);
+            if (color_deltaE(lab[s], reported_lab[s]) > report_delta_e)
+                moved = true;
+        }
+        if (moved)
+            memcpy(reported_lab, lab, sizeof(reported_lab));
+    }
+    lab_reported = lab_reported || moved;
+    if (moved)
+        auto_reports++;
+    return moved;
 }
 
 bool readColor() {
-    switch (reading_state) {
-        case NotStarted:
-            if (currentMode == RunningManual ||
-                next_iteration_timer.isReady()) {
-                debug(F("Enabled RED led. Waiting."));
-                reading_state = WaitingRed;
-                enable_led(Red);
-                color_switch_timer.reset();
-            }
-            return false;
-            break;
-        case WaitingRed:
-            if (color_switch_timer.isReady()) {
-                debug(F("Started reading level of RED."));
-                reading_state = ReadingRed;
-                level_sum = 0;
-                read_repeats_left = CONSECUTIVE_READINGS_COUNT;
-            }
-            return false;
-            break;
-        case ReadingRed:
-            readColorLevel(Red);
-            if (!read_repeats_left) {
-                current_R = adjustColorLevel(
-                    Color::Red, level_sum / CONSECUTIVE_READINGS_COUNT);
-                debug(F("Ended reading level of RED."));
-                debug("RSUM: " + _(level_sum) +
-                      ", C: " + _(CONSECUTIVE_READINGS_COUNT));
-                debug("RED: " + _(current_R));
-                reading_state = WaitingGreen;
-                debug(F("Disabled RED led & enabled GREEN led. Waiting."));
-                disable_led(Red);
-                enable_led(Green);
-                color_switch_timer.reset();
-            }
-            return false;
-            break;
-        case WaitingGreen:
-            if (color_switch_timer.isReady()) {
-                debug(F("Started reading level of GREEN."));
-                reading_state = ReadingGreen;
-                level_sum = 0;
-                read_repeats_left = CONSECUTIVE_READINGS_COUNT;
-            }
-            return false;
-            break;
-        case ReadingGreen:
-            readColorLevel(Green);
-            if (!read_repeats_left) {
-                current_G = adjustColorLevel(
-                    Color::Green, level_sum / CONSECUTIVE_READINGS_COUNT);
-                debug(F("Ended reading level of GREEN."));
-                debug("GSUM: " + _(level_sum) +
-                      ", C: " + _(CONSECUTIVE_READINGS_COUNT));
-                debug("GREEN: " + _(current_G));
-                reading_state = WaitingGreen;
-                debug(F("Disabled GREEN led & enabled BLUE led. Waiting."));
-                reading_state = WaitingBlue;
-                disable_led(Green);
-                enable_led(Blue);
-                color_switch_timer.reset();
+    if (!sequencer.isRunning() && currentMode == RunningAuto &&
+        !auto_reading_due)
+        return false;
+    if (!acquireLevels())
+        return false;
+    for (uint8_t s = 0; s < SENSOR_COUNT; ++s)
+        for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i)
+            current_rgb[s][i] = adjustColorLevel(
+                s, i, levelTo10Bit(current_levels[s][i]));
+    updateLedRanging();
+    const uint8_t *rgb = current_rgb[0];
+#if ENABLE_SERIAL_DEBUG
+    ColorLab previous_lab = current_lab;
+#endif
+    color_toLab(rgb[Red], rgb[Green], rgb[Blue], current_lab);
+    history.push(rgb[Red], rgb[Green], rgb[Blue]);
+    for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i)
+        color_stats[i].add(rgb[i]);
+    debug(F("dE x100 since last reading: "),
+          color_deltaE(current_lab, previous_lab));
+    PROFILE_BEGIN(display);
+    displayColor(colorMoved());
+    PROFILE_END(display, ProfileDisplay);
+    return true;
+}
+
+// Вторая строка - только цифры и латиница: название образца в первой уже
+// занимает 7-8 из 8 знакомест для русских букв
+void showCalibrationProgress() {
+    TextBuffer<LCD_COLS> text;
+    if (calibration_state == PlacingWhite || calibration_state == PlacingBlack)
+        text.addDec(calibration_countdown).add(F(" c"));  // секунд до замера
+    else
+        text.addDec(calibration_reads + 1).add('/').addDec(CALIBRATION_READS);
+    lcd_clearRow(1);
+    lcd_printCenter(text.c_str(), 1);
+}
+
+// Задача планировщика: прошла секунда обратного отсчёта
+void calibrationSecondElapsed() {
+    if (!calibration_countdown)
+        return;
+    calibration_countdown--;
+    showCalibrationProgress();
+    if (calibration_countdown)
+        scheduler.schedule(calibrationSecondElapsed, 1000);
+}
+
+void enterCalibrationState(CalibrationState state) {
+    calibration_state = state;
+    calibration_countdown = CALIBRATION_PLACE_TIME;
+    calibration_reads = 0;
+    memset(calibration_sums, 0, sizeof(calibration_sums));
+    scheduler.schedule(calibrationSecondElapsed, 1000);
+    screen.clear();
+    lcd_printCenter(state == PlacingWhite ? LF(L"Белый образец")
+                                          : LF(L"Чёрный образец"),
+                    0);
+    showCalibrationProgress();
+}
+
+void startCalibration() {
+    if (currentMode == Calibrating)
+        return;
+    debug(F("Entering CALIBRATION mode..."));
+    sequencer.cancel();
+    manual_state = Idle;
+    // Калибровочные уровни - при полной яркости, к ней приводятся остальные
+    resetLedRanging();
+    modeBeforeCalibration =
+        currentMode == Paused ? modeBeforePause : currentMode;
+    currentMode = Mode::Calibrating;
+    sendModeToSerial(Calibrating);
+    enterCalibrationState(PlacingWhite);
+}
+
+// Вернуться в прежний режим. Калибровочные данные меняются, только если
+// оба образца считаны
+void finishCalibration() {
+    sequencer.cancel();
+    scheduler.cancel(calibrationSecondElapsed);
+    scheduler.cancel(finishCalibration);
+    calibration_state = NotCalibrating;
+    refreshScreen = true;
+    if (modeBeforeCalibration == RunningManual)
+        switchToManual();
+    else
+        switchToAuto();
+}
+
+void cancelCalibration() {
+    debug(F("Calibration cancelled"));
+    finishCalibration();
+}
+
+void printCalibrationLevels(const __FlashStringHelper *title, uint8_t sensor,
+                            const uint16_t levels[ACQUISITION_CHANNELS]) {
+    serial_batch.flush();
+    Serial.print(title);
+    if (SENSOR_COUNT > 1)
+        Serial.print(sensor);
+    for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i) {
+        Serial.print(i ? SERIAL_MESSAGE_VALUES_SEP : ' ');
+        Serial.print(levels[i]);
+    }
+    Serial.println();
+}
+
+// Итог калибровки - в Serial и на экран. В прежний режим по истечении
+// CALIBRATION_RESULT_TIME или по нажатию энкодера, без остановки loop()
+void showCalibrationResult(bool done) {
+    Serial.println(done ? F("Calibration done")
+                        : F("Calibration failed: white >= black"));
+    calibration_state = ShowingResult;
+    screen.clear();
+    lcd_printCenter(LF(L"Калибровка"), 0);
+    // Вторая строка латиницей, как и прогресс калибровки
+    lcd_printCenter(done ? "done" : "failed: W >= B", 1);
+    scheduler.schedule(finishCalibration, CALIBRATION_RESULT_TIME * 1000UL);
+}
+
+// Образец считан нужное количество раз: сохранить средние уровни.
+// Калибровка применяется, только если все датчики прошли проверку
+void completeCalibrationState() {
+    uint16_t levels[SENSOR_COUNT][ACQUISITION_CHANNELS];
+    for (uint8_t s = 0; s < SENSOR_COUNT; ++s)
+        for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i)
+            levels[s][i] = (calibration_sums[s][i] + CALIBRATION_READS / 2) /
+                           CALIBRATION_READS;
+
+    if (calibration_state == ReadingWhite) {
+        for (uint8_t s = 0; s < SENSOR_COUNT; ++s)
+            printCalibrationLevels(F("White:"), s, levels[s]);
+        memcpy(calibration_white, levels, sizeof(calibration_white));
+        enterCalibrationState(PlacingBlack);
+        return;
+    }
+
+    for (uint8_t s = 0; s < SENSOR_COUNT; ++s) {
+        printCalibrationLevels(F("Black:"), s, levels[s]);
+        for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i) {
+            // На белом света больше, значит уровень должен быть меньше
+            if (calibration_white[s][i] >= levels[s][i]) {
+                showCalibrationResult(false);
+                return;
             }
-            return false;
-            break;
-        case WaitingBlue:
-            if (color_switch_timer.isReady()) {
-                debug(F("Started reading level of BLUE."));
-                reading_state = ReadingBlue;
-                level_sum = 0;
-                read_repeats_left = CONSECUTIVE_READINGS_COUNT;
+        }
+    }
+    memcpy(rgbMin, calibration_white, sizeof(rgbMin));
+    memcpy(rgbMax, levels, sizeof(rgbMax));
+    for (uint8_t s = 0; s < SENSOR_COUNT; ++s)
+        buildTransfer(s, true);
+    if (!DipSwitchParams.dont_save_data)
+        writeCalibrationData();
+    showCalibrationResult(true);
+}
+
+void handleCalibrationIteration() {
+    switch (calibration_state) {
+        case PlacingWhite:
+        case PlacingBlack:
+            if (encoder.isClick())
+                calibration_countdown = 0;
+            if (calibration_countdown)
+                return;
+            scheduler.cancel(calibrationSecondElapsed);
+            calibration_state = (CalibrationState)(calibration_state + 1);
+            showCalibrationProgress();
+            return;
+        case ReadingWhite:
+        case ReadingBlack:
+            if (!acquireLevels())
+                return;
+            for (uint8_t s = 0; s < SENSOR_COUNT; ++s)
+                for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i)
+                    calibration_sums[s][i] +=
+                        levelTo10Bit(current_levels[s][i]);
+            if (++calibration_reads < CALIBRATION_READS) {
+                showCalibrationProgress();
+                return;
             }
-            return false;
-            break;
-        case ReadingBlue:
-            readColorLevel(Blue);
-            if (!read_repeats_left) {
-                current_B = adjustColorLevel(
-                    Color::Blue, level_sum / CONSECUTIVE_READINGS_COUNT);
-                debug("BSUM: " + _(level_sum) +
-                      ", C: " + _(CONSECUTIVE_READINGS_COUNT));
-                debug("BLUE: " + _(current_B));
-                debug(F("Disabled BLUE led. Broadcasting results."));
-                disable_led(Blue);
-                color_switch_timer.reset();
-                displayColor(current_R, current_G, current_B);
-                reading_state = NotStarted;
-            } else {
+            completeCalibrationState();
+            return;
+        case ShowingResult:
+            if (encoder.isClick())
+                finishCalibration();
+            return;
+        default:
+            finishCalibration();
+            return;
+    }
+}
+
+// История в RGB565 и статистика по ячейкам с момента прошлой выгрузки
+void sendHistoryToSerial() {
+    serial_batch.flush();
+    history.dump(Serial);
+    Serial.println(F("stats,color,count,mean x100,variance x100,min,max"));
+    for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i) {
+        RunningStats &stats = color_stats[i];
+        Serial.print(F("stats,"));
+        Serial.print((char)pgm_read_byte(&CHANNEL_LETTERS[i]));
+        Serial.print(',');
+        Serial.print(stats.count());
+        Serial.print(',');
+        Serial.print(stats.meanX100());
+        Serial.print(',');
+        Serial.print(stats.varianceX100());
+        Serial.print(',');
+        Serial.print(stats.count() ? stats.minimum() : 0);
+        Serial.print(',');
+        Serial.println(stats.maximum());
+        stats.reset();
+    }
+}
+
+void setOversampling(uint16_t ratio, uint8_t prescaler, uint8_t bits) {
+    // Уровни одного измерения должны быть в одной разрядности
+    sequencer.cancel();
+    adc_setPrescaler(prescaler);
+    sequencer.setOversampling(ratio, bits);
+    debug(F("Oversampling: "), ratio, F(" x, prescaler 2^"), adc_prescaler(),
+          F(", "), sequencer.resolution(), F(" bits"));
+}
+
+// Текущие режим, настройки и счётчики пакетов
+void sendStatusToSerial() {
+    serial_batch.flush();
+    Serial.println(F("status,mode,delay,oversampling,prescaler,bits,"
+                     "settle min,threshold,windows,format,serial space,"
+                     "lcd space"));
+    Serial.print(F("status,"));
+    Serial.print(modeName(currentMode));
+    Serial.print(',');
+    Serial.print(current_auto_delay);
+    Serial.print(',');
+    Serial.print(sequencer.oversampling());
+    Serial.print(',');
+    Serial.print(adc_prescaler());
+    Serial.print(',');
+    Serial.print(sequencer.resolution());
+    Serial.print(',');
+    Serial.print(settle.minDelay());
+    Serial.print(',');
+    Serial.print(settle.threshold());
+    Serial.print(',');
+    Serial.print(settle.stableWindows());
+    Serial.print(',');
+    Serial.print(serial_format);
+    Serial.print(',');
+    Serial.print(serial_space);
+    Serial.print(',');
+    Serial.println(lcd_space);
+    // Доля времени без сна с прошлого запроса
+    Serial.println(F("power,awake %x100,elapsed ms,slept ms,sleeps,"
+                     "early wakeups"));
+    Serial.print(F("power,"));
+    Serial.print(idle_awakeX100());
+    Serial.print(',');
+    Serial.print(idle_elapsedMs());
+    Serial.print(',');
+    Serial.print(idle_sleptMs());
+    Serial.print(',');
+    Serial.print(idle_sleeps());
+    Serial.print(',');
+    Serial.println(idle_earlyWakeups());
+    idle_reset();
+    // Выборок на уровень по фазам в последнем измерении
+    Serial.println(F("samples,tolerance x16,min,used by phase"));
+    Serial.print(F("samples,"));
+    Serial.print(sequencer.earlyStopTolerance());
+    Serial.print(',');
+    Serial.print(sequencer.earlyStopMinSamples());
+    for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i) {
+        Serial.print(',');
+        Serial.print(sequencer.samplesUsed(i));
+    }
+    Serial.println();
+    // Запуск по изменению: измерения в автоматическом режиме с прошлого
+    // запроса
+    Serial.println(F("trigger,threshold,dE x100,probe delay,probes,"
+                     "readings,sent"));
+    Serial.print(F("trigger,"));
+    Serial.print(trigger_threshold);
+    Serial.print(',');
+    Serial.print(report_delta_e);
+    Serial.print(',');
+    Serial.print(probe_delay);
+    Serial.print(',');
+    Serial.print(auto_probes);
+    Serial.print(',');
+    Serial.print(auto_readings);
+    Serial.print(',');
+    Serial.println(auto_reports);
+    auto_probes = auto_readings = auto_reports = 0;
+    // Скважности светодиодов по фазам к следующему измерению
+    Serial.println(F("ranging,sensor,target,duty by phase"));
+    for (uint8_t s = 0; s < SENSOR_COUNT; ++s) {
+        Serial.print(F("ranging,"));
+        Serial.print(s);
+        Serial.print(',');
+        Serial.print(led_ranging_target);
+        for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i) {
+            Serial.print(',');
+            Serial.print(sequencer.duty(i, s));
+        }
+        Serial.println();
+    }
+#if ENABLE_ISOLATED_HEADS
+    // Измерений каждого датчика и среднее время от начала измерения до
+    // его последней фазы с прошлого запроса
+    Serial.println(F("head,sensor,policy,readings,latency ms"));
+    for (uint8_t s = 0; s < SENSOR_COUNT; ++s) {
+        Serial.print(F("head,"));
+        Serial.print(s);
+        Serial.print(',');
+        Serial.print(sequencer.policy());
+        Serial.print(',');
+        Serial.print(sequencer.readings(s));
+        Serial.print(',');
+        Serial.println(sequencer.latency(s));
+    }
+    sequencer.resetStats();
+#endif
+    Serial.println(F("batch,size,deadline,policy,dropped,sent"));
+    Serial.print(F("batch,"));
+    Serial.print(serial_batch.size());
+    Serial.print(',');
+    Serial.print(serial_batch.deadline());
+    Serial.print(',');
+    Serial.print(serial_batch.policy() == BatchLatest ? F("latest")
+                                                      : F("queue"));
+    Serial.print(',');
+    Serial.print(serial_batch.dropped());
+    Serial.print(',');
+    Serial.println(serial_batch.batches());
+}
+
+void setAutoDelay(uint32_t delay) {
+    current_auto_delay = constrain(delay, MIN_AUTO_DELAY, MAX_AUTO_DELAY);
+    // Ожидаемое измерение переносится на новую задержку от текущего
+    // момента. Пробное ждёт своей задержки, как в handleAutoIteration()
+    if (scheduler.isScheduled(autoReadingDue))
+        scheduler.schedule(autoReadingDue, auto_state == AutoProbe
+                                               ? probe_delay
+                                               : current_auto_delay);
+}
+
+// Изменить задержку на step мс. Считаем со знаком: раньше уменьшение
+// ниже нуля переполняло задержку, и она прыгала на MAX_AUTO_DELAY.
+// Ожидаемое измерение переносится, как и по команде
+void adjustAutoDelay(int16_t step) {
+    int32_t delay = (int32_t)current_auto_delay + step;
+    setAutoDelay(
+        constrain(delay, (int32_t)MIN_AUTO_DELAY, (int32_t)MAX_AUTO_DELAY));
+}
+
+// Одно измерение, как по нажатию энкодера в ручном режиме
+void startManualReading() {
+    if (currentMode != RunningManual)
+        switchToManual();
+    if (manual_state == Reading)
+        return;
+    // Состояние измерения - латиницей во второй строке: смена кириллицы
+    // перерисовывала бы экран целиком и с ожиданием (см. LcdFramebuffer)
+    lcd_clearRow(1);
+    lcd_printCenter("...", 1);
+    manual_state = Reading;
+}
+
+// Выполнить принятую команду. false - неизвестная команда или
+// недопустимые аргументы
+bool executeSerialCommand(const CommandParser &command) {
+    // Во время калибровки можно только отменить её и узнать состояние
+    if (currentMode == Calibrating &&
+        command.command() != SERIAL_COMMAND_CALIBRATE &&
+        command.command() != SERIAL_COMMAND_STATUS)
+        return false;
+    switch (command.command()) {
+        case SERIAL_COMMAND_AUTO:
+            if (command.argCount() > 1 || command.arg(0) < 0)
                 return false;
-            }
-            break;
+            if (command.argCount())
+                setAutoDelay(command.arg(0));
+            switchToAuto();
+            return true;
+        case SERIAL_COMMAND_MANUAL:
+            switchToManual();
+            return true;
+        case SERIAL_COMMAND_PAUSE:
+            if (currentMode != Paused)
+                pause();
+            return true;
+        case SERIAL_COMMAND_READ:
+            startManualReading();
+            return true;
+        case SERIAL_COMMAND_DELAY:
+            if (command.argCount() != 1 || command.arg(0) < 0)
+                return false;
+            setAutoDelay(command.arg(0));
+            return true;
+        case SERIAL_COMMAND_OVERSAMPLING:
+            if (command.argCount() != 3 || command.arg(0) < 0 ||
+                command.arg(0) > UINT16_MAX ||
+                command.arg(1) < ADC_PRESCALER_MIN_LOG2 ||
+                command.arg(1) > ADC_PRESCALER_MAX_LOG2 ||
+                command.arg(2) < ADC_RESOLUTION_BITS ||
+                command.arg(2) > ACQUISITION_MAX_BITS)
+                return false;
+            setOversampling(command.arg(0), command.arg(1), command.arg(2));
+            return true;
+        case SERIAL_COMMAND_SETTLE:
+            if (command.argCount() != 3 || command.arg(0) < 0 ||
+                command.arg(0) > COLOR_SWITCH_DELAY || command.arg(1) < 0 ||
+                command.arg(1) > UINT8_MAX || command.arg(2) < 1 ||
+                command.arg(2) > UINT8_MAX)
+                return false;
+            // Новые параметры действуют со следующего измерения
+            sequencer.cancel();
+            settle.setMinDelay(command.arg(0));
+            settle.setThreshold(command.arg(1));
+            settle.setStableWindows(command.arg(2));
+            return true;
+        case SERIAL_COMMAND_SPACE:
+            if (command.argCount() != 2 || command.arg(0) < 0 ||
+                command.arg(0) >= ColorSpaces || command.arg(1) < 0 ||
+                command.arg(1) >= ColorSpaces)
+                return false;
+            serial_space = (ColorSpace)command.arg(0);
+            lcd_space = (ColorSpace)command.arg(1);
+            return true;
+        case SERIAL_COMMAND_FORMAT:
+            if (command.argCount() != 1 || command.arg(0) < TextFormat ||
+                command.arg(0) > BinaryLevelsFormat)
+                return false;
+            serial_batch.flush();
+            serial_format = (SerialFormat)command.arg(0);
+            return true;
+        case SERIAL_COMMAND_BATCH:
+            if (command.argCount() != 3 || command.arg(0) < 1 ||
+                command.arg(0) > SERIAL_BATCH_CAPACITY ||
+                command.arg(1) < 0 || command.arg(1) > UINT16_MAX ||
+                command.arg(2) < BatchQueue || command.arg(2) > BatchLatest)
+                return false;
+            serial_batch.configure(command.arg(0), command.arg(1),
+                                   (BatchPolicy)command.arg(2));
+            return true;
+        case SERIAL_COMMAND_CALIBRATE:
+            if (currentMode == Calibrating)
+                cancelCalibration();
+            else
+                startCalibration();
+            return true;
+        case SERIAL_COMMAND_HISTORY:
+            sendHistoryToSerial();
+            return true;
+#if ENABLE_PROFILER
+        case SERIAL_COMMAND_PROFILE:
+            serial_batch.flush();
+            profiler_dump(Serial, PROFILE_NAMES, ProfileSlots);
+            profiler_reset();
+            return true;
+#endif
+        case SERIAL_COMMAND_STATUS:
+            sendStatusToSerial();
+            return true;
+        case SERIAL_COMMAND_EARLY_STOP:
+            if (command.argCount() != 2 || command.arg(0) < 0 ||
+                command.arg(0) > ADC_MAX_TOLERANCE_X16 ||
+                command.arg(1) < 2 || command.arg(1) > UINT16_MAX)
+                return false;
+            sequencer.cancel();
+            sequencer.setEarlyStop(command.arg(0), command.arg(1));
+            return true;
+        case SERIAL_COMMAND_RANGING:
+            if (command.argCount() != 1 || command.arg(0) < 0 ||
+                command.arg(0) > 1023)
+                return false;
+            led_ranging_target = command.arg(0);
+            if (!led_ranging_target)
+                resetLedRanging();
+            return true;
+        case SERIAL_COMMAND_TRIGGER:
+            if (command.argCount() != 3 || command.arg(0) < 0 ||
+                command.arg(0) > UINT8_MAX || command.arg(1) < 0 ||
+                command.arg(1) > UINT16_MAX ||
+                command.arg(2) < (int32_t)MIN_PROBE_DELAY ||
+                command.arg(2) > (int32_t)MAX_PROBE_DELAY)
+                return false;
+            sequencer.cancel();
+            trigger_threshold = command.arg(0);
+            report_delta_e = command.arg(1);
+            probe_delay = command.arg(2);
+            // Следующее измерение - полное, с отправкой
+            auto_state = AutoFull;
+            lab_reported = false;
+            return true;
+#if ENABLE_ISOLATED_HEADS
+        case SERIAL_COMMAND_HEADS:
+            if (command.argCount() != 1 || command.arg(0) < HeadsSequential ||
+                command.arg(0) > HeadsPipelined)
+                return false;
+            sequencer.cancel();
+            sequencer.setPolicy((HeadPolicy)command.arg(0));
+            return true;
+#endif
+        default:
+            return false;
     }
+}
+
+// Принять пришедшие байты команд, не дожидаясь конца строки.
+// За один проход loop() выполняется не больше одной команды
+void handleSerialInput() {
+    while (Serial.available()) {
+        if (!serial_command.feed(Serial.read()))
+            continue;
+        bool done =
+            serial_command.valid() && executeSerialCommand(serial_command);
+        serial_batch.flush();
+        Serial.print(done ? F("ok,") : F("error,"));
+        Serial.println(serial_command.command());
+        return;
+    }
+}
+
+// Скважности к следующему измерению те же, что в последнем: подстройка
+// яркости закончилась, значения цвета больше не сдвигаются из-за неё
+bool ledRangingSettled() {
+    for (uint8_t i = 0; i < ACQUISITION_CHANNELS; ++i)
+        for (uint8_t s = 0; s < SENSOR_COUNT; ++s)
+            if (sequencer.duty(i, s) != current_duty[s][sequencer.slot(i)])
+                return false;
     return true;
 }
 
 void handleAutoIteration() {
+    if (auto_state == AutoProbe) {
+        if (!sequencer.isRunning() && !auto_reading_due)
+            return;
+        bool changed;
+        if (!probeColor(changed))
+            return;
+        if (changed) {
+            // Полное измерение сразу, auto_reading_due остаётся взведённым
+            debug(F("Change detected, starting full reading."));
+            auto_state = AutoFull;
+            return;
+        }
+        auto_reading_due = false;
+        scheduler.schedule(autoReadingDue, probe_delay);
+        return;
+    }
     if (!readColor()) {
         return;
     }
     // обновляем интервал до сл. итерации
     debug(F("Waiting for the next iteration."));
-    next_iteration_timer.setInterval(current_auto_delay);
+    auto_reading_due = false;
+    scheduler.schedule(autoReadingDue, current_auto_delay);
+    // Пока подстраивается яркость, полные измерения идут подряд
+    if (trigger_threshold && ledRangingSettled())
+        auto_state = AutoProbe;
     debug(F("-----"));
 }
 
 void handleManualIteration() {
     if (encoder.isClick()) {
         if (manual_state == Idle) {
-            lcd_printCenter(L"Считываем", 0);
-            manual_state = Reading;
+            startManualReading();
         } else {
-            switchAllLeds();
+            sequencer.cancel();
             manual_state = Idle;
-            reading_state = NotStarted;
-            lcd_printCenter(L"  Готов! ", 0);
+            lcd_clearRow(1);
         }
     }
-    if (manual_state == Reading)
-        if (readColor()) {
-            manual_state = Idle;
-            reading_state = NotStarted;
-            lcd_printCenter(L"  Готов! ", 0);
-        }
+    // Готовый цвет заменяет "..." во второй строке
+    if (manual_state == Reading && readColor())
+        manual_state = Idle;
 }
 
 void handlePausedIteration() {
+    if (encoder.isHolded()) {
+        startCalibration();
+        return;
+    }
     if (encoder.isClick() || modeButton.isClick() || modeButton.isHolded()) {
         pause();
         return;
     }
 }
 
-void handleCalibrationIteration() {
-    Serial.println("White");
-    delay(10000);
-    // rgbMin[Color::Red] = readColorLevel(Color::Red, 7);
-    // rgbMin[Color::Green] = readColorLevel(Color::Green, 7);
-    // rgbMin[Color::Blue] = readColorLevel(Color::Blue, 7);
-    Serial.println("WR: " + String(rgbMin[Color::Red]));
-    Serial.println("WG: " + String(rgbMin[Color::Green]));
-    Serial.println("WB: " + String(rgbMin[Color::Blue]));
-
-    Serial.println("Black");
-    delay(10000);
-    // rgbMax[Color::Red] = readColorLevel(Color::Red, 7);
-    // rgbMax[Color::Green] = readColorLevel(Color::Green, 7);
-    // rgbMax[Color::Blue] = readColorLevel(Color::Blue, 7);
-    Serial.println("BR: " + String(rgbMax[Color::Red]));
-    Serial.println("BG: " + String(rgbMax[Color::Green]));
-    Serial.println("BB: " + String(rgbMax[Color::Blue]));
-    delay(5000);
-}
-
 void setup() {
     Serial.begin(19200);
     debug(F("INIT START"));
     lcd_init();
     lcd_displayLoadingScreen();
-    lcd.clear();
+    screen.clear();
     currentMode = Mode::Loading;
 
     debug(F("Reading EEPROM & trying to receive calibration data..."));
 
-    for (uint8_t i = 0; i < 3; ++i) {
-        // EEPROM.get(i, rgbMin[i]);
-        // EEPROM.get(i + 3, rgbMax[i]);
-        rgbMin[i] = 0;
-        rgbMax[i] = 255;
-    }
+    for (uint8_t s = 0; s < SENSOR_COUNT; ++s) {
+        bool calibrated = readCalibrationData(s);
+        debug(F("Sensor "), s, F(" calibration data: "),
+              calibrated ? F("loaded") : F("missing, using full ADC range"));
+        buildTransfer(s, calibrated);
 
-    debug("B values: " + String(rgbMin[0]) + ", " + String(rgbMin[1]) + ", " +
-          String(rgbMin[2]));
-    debug("W values: " + String(rgbMin[3]) + ", " + String(rgbMin[4]) + ", " +
-          String(rgbMin[5]));
+        debug(F("B values: "), rgbMin[s][0], F(", "), rgbMin[s][1], F(", "),
+              rgbMin[s][2]);
+        debug(F("W values: "), rgbMax[s][0], F(", "), rgbMax[s][1], F(", "),
+              rgbMax[s][2]);
+    }
 
     debug(F("Setting LED pins to OUTPUT mode"));
 
-    for (uint8_t ledPin : ledPins)
-        pinMode(ledPin, OUTPUT);
+    sequencer.begin();
+
+    debug(F("Setting up ADC sampling"));
+    adc_begin(SENSOR_PINS, SENSOR_COUNT);
+    serial_batch.setSensorTags(SENSOR_COUNT > 1);
+    adc_setNoiseReduction(ENABLE_ADC_NOISE_REDUCTION);
+    sequencer.setOversampling(DEFAULT_OVERSAMPLING, DEFAULT_LEVEL_BITS);
+    sequencer.setEarlyStop(DEFAULT_EARLY_STOP_TOLERANCE,
+                           EARLY_STOP_MIN_SAMPLES);
+#if ENABLE_ISOLATED_HEADS
+    sequencer.setPolicy(DEFAULT_HEAD_POLICY);
+#endif
+
+#if ENABLE_ENCODER_INTERRUPTS
+    encoder_interrupts = encoder.attachInterrupts();
+    if (!encoder_interrupts) {
+        debug(F("Encoder pins have no external interrupts, polling"));
+    }
+#endif
+
+#if ENABLE_PROFILER
+    profiler_begin();
+#endif
 
     currentMode = Mode::RunningAuto;
     switchToAuto();
+    if (DipSwitchParams.calibrate_on_start)
+        startCalibration();
+}
+
+// Проверка после каждого пробуждения: есть работа для loop()
+bool wakeRequested() {
+    return Serial.available() || encoder.isTurnQueued() ||
+           digitalRead(MODE_BUTTON_PIN) == LOW ||
+           digitalRead(ENCODER_SW_PIN) == LOW;
+}
+
+// Спать можно, только если до ближайшего срока планировщика loop()
+// гарантированно нечего делать
+bool canSleep() {
+    if (wakeRequested()) {
+        last_input_at = millis();
+        return false;
+    }
+    if (!encoder_interrupts || millis() - last_input_at < IDLE_INPUT_GRACE)
+        return false;
+    if (currentMode != RunningAuto && currentMode != RunningManual &&
+        currentMode != Paused)
+        return false;
+    // auto_reading_due остаётся взведённым после смены режима, важен он
+    // только в автоматическом
+    bool reading_due = currentMode == RunningAuto && auto_reading_due;
+    return !sequencer.isRunning() && manual_state == Idle && !reading_due &&
+           !screen.isDirty() && serial_batch.isIdle();
+}
+
+void sleepUntilNextDeadline() {
+    if (!canSleep())
+        return;
+    // Просыпаемся на миллисекунду раньше срока: последний отрезок ожидания
+    // идёт обычными проходами loop(), и срок отрабатывается так же, как
+    // без сна
+    uint32_t ms = min(scheduler.nextWakeup(), IDLE_MAX_SLEEP);
+    if (ms > IDLE_WAKE_MARGIN)
+        idle_sleep(ms - IDLE_WAKE_MARGIN, wakeRequested);
 }
 
 void loop() {
+    PROFILE_LOOP(ProfileLoop);
+    PROFILE_BEGIN(input);
     modeButton.tick();
     encoder.tick();
 
@@ -364,22 +1118,26 @@ void loop() {
             case RunningManual:
                 switchToAuto();
                 break;
+            case Calibrating:
+                cancelCalibration();
+                break;
             default:
                 break;
         }
     }
 
     if (encoder.isLeftH())
-        current_auto_delay -= PRESSED_ROTATION_DELAY_STEP;
+        adjustAutoDelay(-PRESSED_ROTATION_DELAY_STEP);
     else if (encoder.isRightH())
-        current_auto_delay += PRESSED_ROTATION_DELAY_STEP;
+        adjustAutoDelay(PRESSED_ROTATION_DELAY_STEP);
     else if (encoder.isLeft())
-        current_auto_delay -= USUAL_ROTATION_DELAY_STEP;
+        adjustAutoDelay(-USUAL_ROTATION_DELAY_STEP);
     else if (encoder.isRight())
-        current_auto_delay += USUAL_ROTATION_DELAY_STEP;
+        adjustAutoDelay(USUAL_ROTATION_DELAY_STEP);
+    PROFILE_END(input, ProfileInput);
 
-    current_auto_delay =
-        constrain(current_auto_delay, MIN_AUTO_DELAY, MAX_AUTO_DELAY);
+    handleSerialInput();
+    scheduler.tick();
 
     switch (currentMode) {
         case Loading:
@@ -400,4 +1158,14 @@ void loop() {
         default:
             break;
     }
+
+    serial_batch.poll();
+
+    PROFILE_BEGIN(lcd);
+    screen.poll();
+    PROFILE_END(lcd, ProfileLcd);
+
+#if ENABLE_IDLE_SLEEP
+    sleepUntilNextDeadline();
+#endif
 }
\ No newline at end of file
@@ -3,6 +3,33 @@
 
 // Посылать ли отладочную информацию через Serial
 #define ENABLE_SERIAL_DEBUG 0
+// Спать ли во время преобразований АЦП (режим подавления шума)
+#define ENABLE_ADC_NOISE_REDUCTION 0
+// Собирать ли статистику времени фаз loop() (отчёт - команда 'T' в Serial)
+#define ENABLE_PROFILER 0
+// Показывать ли на экране название ближайшего цвета палитры (~2 КБ flash)
+#define ENABLE_COLOR_NAMES 1
+// Декодировать ли поворот энкодера в прерываниях INT0/INT1 (пины 2 и 3),
+// а не опросом в loop(): повороты не теряются, пока loop() занят экраном
+#define ENABLE_ENCODER_INTERRUPTS 1
+// Спать ли между событиями (SLEEP_MODE_IDLE до ближайшего срока
+// планировщика). Работает только вместе с ENABLE_ENCODER_INTERRUPTS
+#define ENABLE_IDLE_SLEEP 1
+// Оптически развязанные датчики, у каждого свои светодиоды (HEAD_PHASES):
+// фазы разных датчиков перекрываются (см. head_scheduler.hpp). Без этого
+// все датчики SENSOR_PINS стоят под общими светодиодами
+#define ENABLE_ISOLATED_HEADS 0
+// Подстраивать ли яркость светодиодов (ШИМ) под целевой уровень АЦП после
+// калибровки: светлые образцы не прижимаются к нулю шкалы
+#define ENABLE_LED_RANGING 1
+
+// В SLEEP_MODE_ADC стоят таймеры: аппаратный ШИМ (Timer0, пин 6) и
+// программный ШИМ на Timer2 (led_pwm.hpp) замирают в том состоянии, в
+// котором застал их сон, и приглушённый светодиод горит то в полную силу,
+// то никак. Подстройка яркости несовместима с подавлением шума
+#if ENABLE_ADC_NOISE_REDUCTION && ENABLE_LED_RANGING
+#error "ENABLE_LED_RANGING needs running timers, disable ENABLE_ADC_NOISE_REDUCTION"
+#endif
 
 #include <GyverButton.h>
 #include <GyverEncoder.h>
@@ -10,7 +37,34 @@
 #include <LCD_1602_RUS.h>
 #include <Wire.h>
 
-LCD_1602_RUS lcd(0x27, 16, 2);
+#include "acquisition.hpp"
+#include "adc_sampler.hpp"
+#include "color_names.hpp"
+#include "color_space.hpp"
+#include "color_transfer.hpp"
+#include "head_scheduler.hpp"
+#include "idle_sleep.hpp"
+#include "led_pwm.hpp"
+#include "lcd_framebuffer.hpp"
+#include "profiler.hpp"
+#include "reading_history.hpp"
+#include "reading_stats.hpp"
+#include "serial_batch.hpp"
+#include "serial_command.hpp"
+#include "serial_frame.hpp"
+#include "settle_detector.hpp"
+#include "text_format.hpp"
+
+// Адрес переходника PCF8574 на шине I2C
+const uint8_t LCD_ADDRESS = 0x27;
+// Максимальная частота обновления экрана (раз в секунду), не зависит от
+// частоты измерений
+const uint8_t LCD_REFRESH_RATE = 5;
+
+LCD_1602_RUS lcd(LCD_ADDRESS, LCD_COLS, LCD_ROWS);
+
+// Теневой буфер экрана, весь вывод на экран идёт через него
+LcdFramebuffer screen(lcd, LCD_ADDRESS);
 
 // Пин красного светодиода
 const uint8_t RED_LED_PIN = 6;
@@ -18,8 +72,19 @@ const uint8_t RED_LED_PIN = 6;
 const uint8_t GREEN_LED_PIN = 7;
 // Пин синего светодиода
 const uint8_t BLUE_LED_PIN = 8;
-// Пин фоторезистора
-const uint8_t SENSOR_PIN = A0;
+// Пины фоторезисторов. Все стоят под одними светодиодами и считываются
+// в одной фазе по кругу (или у каждого свои светодиоды, см.
+// ENABLE_ISOLATED_HEADS), у каждого своя калибровка и свои пакеты.
+// На экран, в историю и статистику идёт первый. A4 и A5 заняты I2C
+#if ENABLE_ISOLATED_HEADS
+const uint8_t SENSOR_PINS[] = {A0, A1};
+#else
+const uint8_t SENSOR_PINS[] = {A0};
+#endif
+// Количество датчиков
+const uint8_t SENSOR_COUNT = sizeof(SENSOR_PINS);
+static_assert(SENSOR_COUNT <= ADC_MAX_CHANNELS,
+              "Too many sensors for the ADC sampler");
 // Пин кнопки смены режимов
 const uint8_t MODE_BUTTON_PIN = 5;
 // Пин CLK энкодера
@@ -29,51 +94,265 @@ const uint8_t ENCODER_DT_PIN = 3;
 // Пин кнопки энкодера (SW)
 const uint8_t ENCODER_SW_PIN = 4;
 
-// Задержка между считываниями одного цвета
-const uint8_t CONSECUTIVE_READINGS_DELAY = 20;
-// Задержка перед считыванием следующего цвета
+// Наибольшая задержка перед считыванием следующего цвета (таймаут
+// ожидания установления сигнала)
 const uint8_t COLOR_SWITCH_DELAY = 200;
-// Количество последовательных считываний одного цвета, уменьшает шум
-const uint8_t CONSECUTIVE_READINGS_COUNT = 7;
+// Наименьшая задержка перед считыванием следующего цвета
+const uint8_t COLOR_SETTLE_MIN_DELAY = 20;
+// Допустимое изменение среднего уровня АЦП за окно (~3.3 мс), при котором
+// сигнал считается установившимся
+const uint8_t COLOR_SETTLE_THRESHOLD = 1;
+// Сколько окон подряд изменение должно быть в пределах допуска
+const uint8_t COLOR_SETTLE_WINDOWS = 3;
+// Количество выборок АЦП на один цвет, уменьшает шум
+// (256 выборок в свободном режиме АЦП занимают ~27 мс)
+const uint16_t CONSECUTIVE_READINGS_COUNT = 256;
+// Передискретизация по умолчанию: 0 - брать CONSECUTIVE_READINGS_COUNT
+// из таблицы фаз. Например, 64 выборки с делителем 32 дают 13 бит за
+// ~1.7 мс на цвет
+const uint16_t DEFAULT_OVERSAMPLING = 0;
+// Разрядность уровней по умолчанию
+const uint8_t DEFAULT_LEVEL_BITS = ADC_RESOLUTION_BITS;
+// Досрочная остановка набора выборок: выборки перестают набираться, когда
+// доверительный интервал среднего (2 сигмы) уже +-допуска. Допуск в 1/16
+// ед. АЦП (10 бит), 0 - всегда набирать все выборки. На установившемся
+// сигнале с шумом ~1 ед. допуск 1/4 ед. набирается за ~50 выборок из 256
+const uint8_t DEFAULT_EARLY_STOP_TOLERANCE = 4;
+// Меньше этого выборок на уровень не набирается: разброс по нескольким
+// выборкам ненадёжен
+const uint16_t EARLY_STOP_MIN_SAMPLES = 32;
+
+// Целевой уровень АЦП (10 бит) при подстройке яркости светодиодов: у
+// делителя с фоторезистором здесь наибольшая чувствительность к
+// относительному изменению света. 0 - светодиоды всегда в полную силу
+const uint16_t LED_RANGING_TARGET = ENABLE_LED_RANGING ? 512 : 0;
+// Отклонение от цели (ед. АЦП), при котором яркость не меняется
+const uint16_t LED_RANGING_TOLERANCE = 64;
+// Наименьшая скважность светодиода
+const uint8_t LED_MIN_DUTY = 16;
+
+// Показатель степени фоторезистора (R ~ E^-gamma), по нему линеаризуется
+// шкала после калибровки. Для GL55xx - 0.5-0.8
+const float LDR_GAMMA = 0.7;
+
+// Адрес калибровочных данных в EEPROM: для каждого датчика уровни
+// белого, затем чёрного (по 2 байта на цвет)
+const uint8_t EEPROM_CALIBRATION_ADDRESS = 0;
+
+// Время (с), чтобы положить образец при калибровке. Нажатие энкодера
+// начинает считывание раньше
+const uint8_t CALIBRATION_PLACE_TIME = 10;
+// Количество измерений каждого образца при калибровке
+const uint8_t CALIBRATION_READS = 4;
+// Время (с) показа итога калибровки. Нажатие энкодера возвращает в режим
+// раньше
+const uint8_t CALIBRATION_RESULT_TIME = 3;
+
+// Количество измерений в истории (по 2 байта ОЗУ на измерение). На
+// ATmega328 всего 2 КБ: ~1.4 КБ уже занимают буферы Serial, Wire, экрана,
+// пакетов, АЦП и передаточные функции, остальное нужно стеку
+const uint16_t HISTORY_SIZE = 64;
+
+// Наибольшая длительность одного сна (мс), когда в планировщике нет задач
+const uint32_t IDLE_MAX_SLEEP = 1000;
+// Сколько (мс) после нажатия кнопки не засыпать: GButton и Encoder
+// распознают клик и удержание по времени между вызовами tick()
+const uint32_t IDLE_INPUT_GRACE = 1000;
+// За сколько (мс) до срока просыпаться
+const uint32_t IDLE_WAKE_MARGIN = 1;
+
+// Запуск по изменению в автоматическом режиме: вместо полного измерения
+// каждые current_auto_delay идёт пробное - один светодиод (фазы по
+// кругу). Полное измерение начинается, только если значение цвета этой
+// фазы (0-255) хотя бы у одного датчика отошло от последнего полного
+// больше чем на порог. 0 - полное измерение каждый раз
+const uint8_t DEFAULT_TRIGGER_THRESHOLD = 0;
+// Дельта E x100, на которую цвет хотя бы одного датчика должен сдвинуться
+// от последнего отправленного, чтобы измерение в автоматическом режиме
+// ушло в Serial. 0 - отправлять каждое измерение
+const uint16_t DEFAULT_REPORT_DELTA_E = 0;
+// Задержка (мс) между пробными измерениями. Проба - один светодиод из
+// трёх, поэтому пробы могут идти чаще полных измерений: приход детали
+// замечается раньше, а светодиоды горят не дольше. После полного
+// измерения следующая проба - через current_auto_delay
+const uint32_t DEFAULT_PROBE_DELAY = 50;
+// Пределы задержки между пробами
+const uint32_t MIN_PROBE_DELAY = 10;
+const uint32_t MAX_PROBE_DELAY = 10000;
 
 // Минимальная задержка (мс) между считываниями в автоматическом режиме
 const uint32_t MIN_AUTO_DELAY = 100;
 // Максимальная задержка (мс) между считываниями в автоматическом режиме
 const uint32_t MAX_AUTO_DELAY = 10000;
 // Изменение задержки (мс) при обычном повороте энкодера
-const uint32_t USUAL_ROTATION_DELAY_STEP = 100;
+const int16_t USUAL_ROTATION_DELAY_STEP = 100;
 // Изменение задержки (мс) при повороте энкодера с нажатием
-const uint32_t PRESSED_ROTATION_DELAY_STEP = 500;
+const int16_t PRESSED_ROTATION_DELAY_STEP = 500;
 
 // Последовательность-индикатор начала пакета данных для программы
-const String SERIAL_MESSAGE_START = "$#$";
+const char SERIAL_MESSAGE_START[] PROGMEM = "$#$";
 // Последовательность-индикатор конца пакета данных для программы
-const String SERIAL_MESSAGE_END = "@!@";
+const char SERIAL_MESSAGE_END[] PROGMEM = "@!@";
+// Команды по Serial: строка из буквы и целых аргументов через пробел или
+// запятую (см. serial_command.hpp), ответ - "ok,<буква>" или
+// "error,<буква>" после вывода самой команды.
+// Автоматический режим: 'A' [задержка, мс]
+const char SERIAL_COMMAND_AUTO = 'A';
+// Ручной режим: 'M'
+const char SERIAL_COMMAND_MANUAL = 'M';
+// Пауза: 'P'
+const char SERIAL_COMMAND_PAUSE = 'P';
+// Одно измерение в ручном режиме (с переходом в него): 'R'
+const char SERIAL_COMMAND_READ = 'R';
+// Задержка между измерениями в автоматическом режиме: 'D' мс
+const char SERIAL_COMMAND_DELAY = 'D';
+// Передискретизация: 'O' количество выборок (0 - по таблице фаз),
+// log2 делителя АЦП (2-7), разрядность уровней (10-16)
+const char SERIAL_COMMAND_OVERSAMPLING = 'O';
+// Установление сигнала: 'W' минимальная задержка (мс), допуск (ед. АЦП),
+// количество окон подряд
+const char SERIAL_COMMAND_SETTLE = 'W';
+// Цветовые пространства: 'S' для Serial, для экрана (0 - RGB, 1 - HSV,
+// 2 - XYZ, 3 - L*a*b*)
+const char SERIAL_COMMAND_SPACE = 'S';
+// Формат пакетов: 'F' номер SerialFormat
+const char SERIAL_COMMAND_FORMAT = 'F';
+// Пакетирование измерений: 'B' измерений в пакете (1-4), предельная
+// задержка пакета (мс, 0 - без ожидания), политика при занятом Serial
+// (0 - ждать, 1 - выбрасывать старые измерения)
+const char SERIAL_COMMAND_BATCH = 'B';
+// Начало (или отмена) калибровки: 'C'
+const char SERIAL_COMMAND_CALIBRATE = 'C';
+// Выгрузка истории измерений и статистики (статистика после выгрузки
+// начинается заново): 'H'
+const char SERIAL_COMMAND_HISTORY = 'H';
+// Отчёт профилировщика: 'T'
+const char SERIAL_COMMAND_PROFILE = 'T';
+// Текущие режим и настройки: 'Q'
+const char SERIAL_COMMAND_STATUS = 'Q';
+// Досрочная остановка набора выборок: 'E' допуск (1/16 ед. АЦП, 0 -
+// выключить), наименьшее количество выборок
+const char SERIAL_COMMAND_EARLY_STOP = 'E';
+// Подстройка яркости светодиодов: 'G' целевой уровень АЦП (0 - выключить)
+const char SERIAL_COMMAND_RANGING = 'G';
+// Запуск по изменению в автоматическом режиме: 'U' порог пробы (ед.
+// цвета 0-255, 0 - выключить), дельта E x100 для отправки (0 - отправлять
+// каждое измерение), задержка между пробами (мс)
+const char SERIAL_COMMAND_TRIGGER = 'U';
+// Развязанные датчики (ENABLE_ISOLATED_HEADS): 'I' 0 - по очереди,
+// 1 - с перекрытием фаз
+const char SERIAL_COMMAND_HEADS = 'I';
 // Разделитель значений цветов в пакете
-const String SERIAL_MESSAGE_VALUES_SEP = ",";
+const char SERIAL_MESSAGE_VALUES_SEP = ',';
+// Буква цветового пространства после начала пакета (для RGB её нет,
+// пакет остаётся прежним $#$R,G,B@!@)
+const char SERIAL_SPACE_TAGS[] PROGMEM = " HXL";
+
+// Обозначения компонент на экране (по 3 на пространство, кроме RGB)
+// и делители значений: XYZ и L*a*b* выводятся целыми
+const char LCD_SPACE_LETTERS[] PROGMEM = "HSVXYZLab";
+const uint8_t LCD_SPACE_DIVIDERS[] PROGMEM = {1, 100, 100};
 
-// Цвета светодиода
+// Формат пакетов данных для программы
+enum SerialFormat {
+    TextFormat = 0,   // текстовые пакеты $#$R,G,B@!@
+    BinaryFormat,     // двоичные кадры с цветом RGB (см. serial_frame.hpp)
+    BinaryRawFormat,  // двоичные кадры с 10-битными уровнями АЦП
+    BinaryLevelsFormat  // по кадру на цвет с уровнем полной разрядности и
+                        // кадру с количеством выборок в нём
+};
+
+// Формат пакетов по умолчанию
+const SerialFormat DEFAULT_SERIAL_FORMAT = TextFormat;
+
+// Цветовые пространства по умолчанию для Serial и экрана
+const ColorSpace DEFAULT_SERIAL_SPACE = SpaceRgb;
+const ColorSpace DEFAULT_LCD_SPACE = SpaceRgb;
+
+// Пакетирование измерений по умолчанию: по одному, без задержки - вывод
+// такой же, как без пакетирования
+const uint8_t DEFAULT_BATCH_SIZE = 1;
+const uint16_t DEFAULT_BATCH_DEADLINE = 0;
+const BatchPolicy DEFAULT_BATCH_POLICY = BatchQueue;
+
+// Ячейки калибровки цветных светодиодов. Дополнительные светодиоды
+// (белый, ИК) занимают следующие ячейки: у них есть уровни и калибровка,
+// но в цвет они не входят
 enum Color { Red = 0, Green, Blue, None };
 
 // Режимы работы
 enum Mode { Loading = 0, Paused, RunningAuto, RunningManual, Calibrating };
 
-// Возможные состояния считывания цвета
-enum ReadingColorState {
-    NotStarted = 0,
-    WaitingRed,
-    ReadingRed,
-    WaitingGreen,
-    ReadingGreen,
-    WaitingBlue,
-    ReadingBlue
+// Фазы измерения цвета: светодиод, таймаут установления сигнала,
+// количество выборок, ячейка калибровки
+constexpr AcquisitionPhase ACQUISITION_PHASES[] PROGMEM = {
+    {RED_LED_PIN, COLOR_SWITCH_DELAY, CONSECUTIVE_READINGS_COUNT, Red},
+    {GREEN_LED_PIN, COLOR_SWITCH_DELAY, CONSECUTIVE_READINGS_COUNT, Green},
+    {BLUE_LED_PIN, COLOR_SWITCH_DELAY, CONSECUTIVE_READINGS_COUNT, Blue}};
+
+// Количество фаз (светодиодов) в измерении, по нему размечены все
+// массивы уровней и калибровки (sequencer.channels())
+const uint8_t ACQUISITION_CHANNELS =
+    sizeof(ACQUISITION_PHASES) / sizeof(ACQUISITION_PHASES[0]);
+static_assert(ACQUISITION_CHANNELS > Blue,
+              "ACQUISITION_PHASES needs the red, green and blue phases");
+
+// Обозначения ячеек калибровки в отчётах
+const char CHANNEL_LETTERS[] PROGMEM = "RGBWI";
+static_assert(ACQUISITION_CHANNELS < sizeof(CHANNEL_LETTERS),
+              "Add a letter to CHANNEL_LETTERS for the new channel");
+
+#if ENABLE_ISOLATED_HEADS
+// Фазы развязанных датчиков, по строке на датчик SENSOR_PINS: первый -
+// на прежних светодиодах, второй - на пинах 9-11. Ячейки калибровки
+// в том же порядке, что в ACQUISITION_PHASES
+constexpr AcquisitionPhase HEAD_PHASES[][ACQUISITION_CHANNELS] PROGMEM = {
+    {{RED_LED_PIN, COLOR_SWITCH_DELAY, CONSECUTIVE_READINGS_COUNT, Red},
+     {GREEN_LED_PIN, COLOR_SWITCH_DELAY, CONSECUTIVE_READINGS_COUNT, Green},
+     {BLUE_LED_PIN, COLOR_SWITCH_DELAY, CONSECUTIVE_READINGS_COUNT, Blue}},
+    {{9, COLOR_SWITCH_DELAY, CONSECUTIVE_READINGS_COUNT, Red},
+     {10, COLOR_SWITCH_DELAY, CONSECUTIVE_READINGS_COUNT, Green},
+     {11, COLOR_SWITCH_DELAY, CONSECUTIVE_READINGS_COUNT, Blue}}};
+static_assert(sizeof(HEAD_PHASES) / sizeof(HEAD_PHASES[0]) == SENSOR_COUNT,
+              "HEAD_PHASES needs one row per sensor");
+
+// Перекрывать ли фазы датчиков по умолчанию
+const HeadPolicy DEFAULT_HEAD_POLICY = HeadsPipelined;
+#endif
+
+// Ячейки профилировщика
+enum ProfileSlot {
+    ProfileLoop = 0,    // период loop() целиком
+    ProfileInput,       // опрос кнопок и энкодера
+    ProfileWaiting,     // ожидание установления сигнала
+    ProfileReading,     // считывание уровня
+    ProfileDisplay,     // вывод результата (Serial и буфер экрана)
+    ProfileLcd,         // передача на экран
+    ProfileSlots
+};
+
+// Имена ячеек профилировщика для отчёта
+const char PROFILE_NAMES[] PROGMEM =
+    "loop\0input\0waiting\0reading\0display\0lcd";
+
+// Возможные состояния в автоматическом режиме
+enum AutoState {
+    AutoFull = 0,   // полное измерение всеми светодиодами
+    AutoProbe       // пробное измерение одним светодиодом
 };
 
 // Возможные состояния в ручном режиме
 enum ManualState { Idle = 0, Reading };
 
-// Возможные состоянияя при калибровке
-enum CalibrationState { NotCalibrating = 0, ReadingWhite, ReadingBlack };
+// Возможные состояния при калибровке
+enum CalibrationState {
+    NotCalibrating = 0,
+    PlacingWhite,   // ждём, пока положат белый образец
+    ReadingWhite,
+    PlacingBlack,   // ждём, пока положат чёрный образец
+    ReadingBlack,
+    ShowingResult   // на экране итог калибровки
+};
 
 // Настройки, управляемые DIP-переключателем на плате
 struct {
@@ -81,16 +360,53 @@ struct {
          disable_lcd_backlight = 0, calibrate_on_start = 0, dont_save_data = 0;
 } DipSwitchParams;
 
-// Текущие считанные цвета (0-255)
-uint8_t current_R, current_G, current_B;
+// Текущие считанные значения каждого датчика по ячейкам калибровки
+// (0-255), цвет - первые три
+uint8_t current_rgb[SENSOR_COUNT][ACQUISITION_CHANNELS];
+
+// Текущие усреднённые уровни АЦП каждого датчика для каждой ячейки
+// в разрядности sequencer.resolution() (по умолчанию 10 бит, 0-1023)
+uint16_t current_levels[SENSOR_COUNT][ACQUISITION_CHANNELS];
+
+// Сколько выборок АЦП вошло в current_levels каждого датчика и ячейки
+uint16_t current_samples[SENSOR_COUNT][ACQUISITION_CHANNELS];
+
+// Скважность светодиода каждой ячейки, при которой сняты current_levels
+uint8_t current_duty[SENSOR_COUNT][ACQUISITION_CHANNELS];
+
+// Текущий целевой уровень подстройки яркости (0 - выключена)
+uint16_t led_ranging_target = LED_RANGING_TARGET;
+
+// Текущий формат пакетов данных
+SerialFormat serial_format = DEFAULT_SERIAL_FORMAT;
+
+// Текущие цветовые пространства для Serial и экрана
+ColorSpace serial_space = DEFAULT_SERIAL_SPACE;
+ColorSpace lcd_space = DEFAULT_LCD_SPACE;
+
+// Очередь измерений для Serial (текстовые и двоичные пакеты цветов)
+SerialBatch serial_batch(Serial, SERIAL_MESSAGE_START, SERIAL_MESSAGE_END,
+                         SERIAL_MESSAGE_VALUES_SEP);
+
+// Разбор команд, приходящих по Serial
+CommandParser serial_command;
+
+// Текущий цвет первого датчика в L*a*b* (для дельты E между измерениями)
+ColorLab current_lab;
+
+// Последние измерения (цвет в RGB565) и статистика по каждой ячейке
+ReadingHistory<HISTORY_SIZE> history;
+RunningStats color_stats[ACQUISITION_CHANNELS];
 
-// Пины светодиодов (для удобства)
-constexpr uint8_t ledPins[] = {RED_LED_PIN, GREEN_LED_PIN, BLUE_LED_PIN};
+// Минимальные (белый образец) и максимальные (чёрный образец) уровни АЦП
+// каждого датчика для каждой ячейки, устанавливаются в результате
+// калибровки, без неё - 0 и 1023 (см. readCalibrationData())
+uint16_t rgbMin[SENSOR_COUNT][ACQUISITION_CHANNELS];
+uint16_t rgbMax[SENSOR_COUNT][ACQUISITION_CHANNELS];
 
-// Минимальные и максимальные значения напряжения для каждого из цветов,
-// устанавливаются в результате калибровки
-uint8_t rgbMin[] = {0, 0, 0};
-uint8_t rgbMax[] = {255, 255, 255};
+// Передаточные функции ячеек каждого датчика, строятся по rgbMin и rgbMax
+// (~41 байт ОЗУ на ячейку)
+ColorTransfer transfer[SENSOR_COUNT][ACQUISITION_CHANNELS];
 
 // Текущий режим работы
 Mode currentMode;
@@ -98,33 +414,82 @@ Mode currentMode;
 // Режим работы до паузы
 Mode modeBeforePause;
 
-// Текущее состояние в ручном режиме
-ManualState manual_state = Idle;
+// Текущее состояние в автоматическом режиме
+AutoState auto_state = AutoFull;
+
+// Порог пробы, порог отправки и задержка между пробами (см.
+// DEFAULT_TRIGGER_THRESHOLD)
+uint8_t trigger_threshold = DEFAULT_TRIGGER_THRESHOLD;
+uint16_t report_delta_e = DEFAULT_REPORT_DELTA_E;
+uint32_t probe_delay = DEFAULT_PROBE_DELAY;
+
+// Фаза следующего пробного измерения
+uint8_t probe_phase = 0;
 
-// Текущее состояние считывания цвета
-ReadingColorState reading_state = NotStarted;
+// Цвет каждого датчика в последнем отправленном измерении. false - в
+// этот раз в автоматическом режиме ещё ничего не отправлено
+ColorLab reported_lab[SENSOR_COUNT];
+bool lab_reported = false;
+
+// Пробных и полных измерений и отправленных в автоматическом режиме
+// с прошлого запроса состояния
+uint16_t auto_probes = 0, auto_readings = 0, auto_reports = 0;
+
+// Текущее состояние в ручном режиме. Смена режима прерывает измерение
+// и возвращает Idle, иначе canSleep() не разрешит сон
+ManualState manual_state = Idle;
 
 // Текущее состояние калибровки
 CalibrationState calibration_state = NotCalibrating;
 
+// Режим работы до калибровки
+Mode modeBeforeCalibration;
+
+// Секунд до начала считывания образца
+uint8_t calibration_countdown;
+
+// Количество выполненных измерений образца и суммы их уровней (10 бит)
+// для каждого датчика
+uint8_t calibration_reads;
+uint16_t calibration_sums[SENSOR_COUNT][ACQUISITION_CHANNELS];
+
+// Уровни белого образца для каждого датчика, пока считывается чёрный
+uint16_t calibration_white[SENSOR_COUNT][ACQUISITION_CHANNELS];
+
 // Текущая задержка между считываниями цвета в
 // автоматическом режиме
 uint32_t current_auto_delay = MIN_AUTO_DELAY * 5;
 
-// Оставшееся количество считываний одного и того же цвета
-uint8_t read_repeats_left;
+// Отложенные события: следующее измерение в автоматическом режиме,
+// секунды обратного отсчёта при калибровке
+GScheduler scheduler;
+
+// Пора ли начинать измерение в автоматическом режиме
+bool auto_reading_due = false;
 
-// Текущая сумма значений напряжения с фоторезистора
-uint32_t level_sum;
+// Декодируется ли энкодер в прерываниях (без этого спать нельзя: поворот
+// во сне потеряется)
+bool encoder_interrupts = false;
 
-// Таймер, задержка перед следующим считыванием в автоматическом режиме
-GTimer_ms next_iteration_timer(current_auto_delay);
+// Когда последний раз была нажата кнопка или пришла команда
+uint32_t last_input_at = 0;
 
-// Таймер, задержка перед следующим считыванием того же цвета
-GTimer_ms multiple_readings_timer(CONSECUTIVE_READINGS_DELAY);
+// Ожидание установления сигнала между включением светодиода и началом
+// считывания
+SettleDetector settle(COLOR_SETTLE_MIN_DELAY, COLOR_SWITCH_DELAY,
+                      COLOR_SETTLE_THRESHOLD, COLOR_SETTLE_WINDOWS);
 
-// Таймер, задержка между включением светодиода и началом считывания
-GTimer_ms color_switch_timer(COLOR_SWITCH_DELAY);
+#if ENABLE_ISOLATED_HEADS
+// Измерение цвета развязанными датчиками с перекрытием фаз
+HeadScheduler<ACQUISITION_CHANNELS, SENSOR_COUNT> sequencer(HEAD_PHASES,
+                                                            SENSOR_PINS, settle);
+#else
+// Измерение цвета по таблице фаз, все датчики сразу
+AcquisitionSequencer<ACQUISITION_CHANNELS, SENSOR_COUNT> sequencer(
+    ACQUISITION_PHASES, settle);
+#endif
+static_assert(decltype(sequencer)::channels() == ACQUISITION_CHANNELS,
+              "Level arrays are sized by the sequencer's channel count");
 
 GButton modeButton(MODE_BUTTON_PIN);
 Encoder encoder(ENCODER_CLK_PIN, ENCODER_DT_PIN, ENCODER_SW_PIN, 1);
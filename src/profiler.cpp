@@ -0,0 +1,89 @@
+#include "profiler.hpp"
+
+struct ProfileEntry {
+    uint16_t min, max;
+    uint32_t sum;
+    uint32_t count;
+    uint16_t buckets[PROFILE_BUCKETS];
+};
+
+static ProfileEntry profile_table[PROFILE_MAX_SLOTS];
+static uint16_t profile_loop_started;
+static bool profile_loop_running = false;
+static uint16_t profile_overhead = 0;
+
+void profiler_reset() {
+    for (uint8_t i = 0; i < PROFILE_MAX_SLOTS; ++i) {
+        ProfileEntry &entry = profile_table[i];
+        entry.min = 0xFFFF;
+        entry.max = 0;
+        entry.sum = 0;
+        entry.count = 0;
+        for (uint8_t b = 0; b < PROFILE_BUCKETS; ++b)
+            entry.buckets[b] = 0;
+    }
+    profile_loop_running = false;
+}
+
+void profiler_begin() {
+    profiler_reset();
+    // Смещение замера: сколько записывает пустая пара BEGIN/END (часть
+    // двух вызовов micros() попадает внутрь интервала)
+    const uint8_t runs = 16;
+    uint16_t total = 0;
+    for (uint8_t i = 0; i < runs; ++i) {
+        uint16_t begin = micros();
+        total += (uint16_t)micros() - begin;
+    }
+    profile_overhead = (total + runs / 2) / runs;
+}
+
+void profiler_record(uint8_t slot, uint16_t us) {
+    if (slot >= PROFILE_MAX_SLOTS)
+        return;
+    ProfileEntry &entry = profile_table[slot];
+    us = us > profile_overhead ? us - profile_overhead : 0;
+    if (us < entry.min)
+        entry.min = us;
+    if (us > entry.max)
+        entry.max = us;
+    entry.sum += us;
+    entry.count++;
+    uint8_t bucket = 0;
+    for (uint16_t v = us >> 1; v && bucket < PROFILE_BUCKETS - 1; v >>= 1)
+        bucket++;
+    if (entry.buckets[bucket] != 0xFFFF)
+        entry.buckets[bucket]++;
+}
+
+void profiler_loopTick(uint8_t slot) {
+    uint16_t now = micros();
+    if (profile_loop_running)
+        profiler_record(slot, now - profile_loop_started);
+    profile_loop_started = now;
+    profile_loop_running = true;
+}
+
+void profiler_dump(Print &out, const char *names, uint8_t slots) {
+    out.print(F("overhead,"));
+    out.println(profile_overhead);
+    out.println(F("slot,count,min,mean,max,histogram (2^i us)"));
+    for (uint8_t i = 0; i < slots && i < PROFILE_MAX_SLOTS; ++i) {
+        ProfileEntry &entry = profile_table[i];
+        out.print(reinterpret_cast<const __FlashStringHelper *>(names));
+        names += strlen_P(names) + 1;
+        out.print(',');
+        out.print(entry.count);
+        out.print(',');
+        out.print(entry.count ? entry.min : 0);
+        out.print(',');
+        out.print(entry.count ? entry.sum / entry.count : 0);
+        out.print(',');
+        out.print(entry.max);
+        for (uint8_t b = 0; b < PROFILE_BUCKETS; ++b) {
+            out.print(b ? ' ' : ',');
+            out.print(entry.buckets[b]);
+        }
+        out.println();
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <Arduino.h>
+
+/*
+    Профилировщик горячего пути.
+    - Для каждой ячейки (фазы loop()) копятся min / max / среднее время в
+      мкс и гистограмма по степеням двойки: корзина i - длительности
+      от 2^i до 2^(i+1)-1 мкс, последняя корзина - всё, что дольше
+    - Время берётся из micros(): разрешение 4 мкс на 16 МГц
+    - Без ENABLE_PROFILER (см. main.hpp) макросы PROFILE_* пустые, а функции
+      и таблица не попадают в прошивку (--gc-sections)
+    - Пара PROFILE_BEGIN/PROFILE_END - два вызова micros() и одна запись
+      в таблицу. Часть вызовов micros() попадает внутрь интервала: это
+      смещение измеряется при profiler_begin() пустыми парами, вычитается
+      из каждой записи (и из периода loop()) и печатается в отчёте
+      строкой "overhead". Запись в таблицу в интервалы не попадает, но
+      удлиняет период loop() на каждую пару в нём
+    - Таблица: PROFILE_MAX_SLOTS * 44 байта RAM
+*/
+
+// Наибольшее количество ячеек
+const uint8_t PROFILE_MAX_SLOTS = 6;
+// Количество корзин гистограммы
+const uint8_t PROFILE_BUCKETS = 16;
+
+void profiler_begin();                          // очистить таблицу, измерить цену замера
+void profiler_reset();                          // очистить таблицу
+void profiler_record(uint8_t slot, uint16_t us);  // записать одну длительность
+void profiler_loopTick(uint8_t slot);           // записать время с прошлого вызова (период loop())
+// Вывести таблицу; names - имена ячеек в PROGMEM через '\0'
+void profiler_dump(Print &out, const char *names, uint8_t slots);
+
+#if ENABLE_PROFILER
+#define PROFILE_BEGIN(name) uint16_t _profile_##name = micros()
+#define PROFILE_END(name, slot) \
+    profiler_record(slot, (uint16_t)micros() - _profile_##name)
+#define PROFILE_LOOP(slot) profiler_loopTick(slot)
+#else
+#define PROFILE_BEGIN(name)
+#define PROFILE_END(name, slot)
+#define PROFILE_LOOP(slot)
+#endif
+
+#endif
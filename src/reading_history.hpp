@@ -0,0 +1,67 @@
+#ifndef READING_HISTORY_HPP
+#define READING_HISTORY_HPP
+
+#include <Arduino.h>
+
+#include "text_format.hpp"
+
+/*
+    История последних N измерений в ОЗУ.
+    - Кольцевой буфер, цвет упакован в RGB565 (2 байта вместо 3); при
+      переполнении затираются самые старые измерения
+    - Выгружается одним пакетом по запросу, например если связь с
+      программой на ПК прерывалась
+*/
+
+template <uint16_t N>
+class ReadingHistory {
+  public:
+    void push(uint8_t r, uint8_t g, uint8_t b) {
+        _packed[_head] = ((uint16_t)(r & 0xF8) << 8) | ((g & 0xFC) << 3) |
+                         (b >> 3);
+        _head = _head + 1 == N ? 0 : _head + 1;
+        if (_size < N)
+            _size++;
+        _total++;
+    }
+
+    void clear() { _head = _size = 0; }
+
+    uint16_t size() const { return _size; }
+    static uint16_t capacity() { return N; }
+    // Всего измерений с начала работы, по нему программа на ПК видит,
+    // сколько пропущено между выгрузками
+    uint32_t total() const { return _total; }
+
+    // Упакованное измерение, 0 - самое старое
+    uint16_t packed(uint16_t index) const {
+        uint16_t position = _head + N - _size + index;
+        return _packed[position >= N ? position - N : position];
+    }
+
+    // "history,<size>,<total>", затем строки по 16 значений RGB565 в HEX
+    void dump(Print &out) const {
+        out.print(F("history,"));
+        out.print(_size);
+        out.print(',');
+        out.println(_total);
+        TextBuffer<16 * 5> line;
+        for (uint16_t i = 0; i < _size; ++i) {
+            uint16_t value = packed(i);
+            if (line.length())
+                line.add(' ');
+            line.addHex(value >> 8).addHex(value);
+            if (line.length() + 5 > line.capacity() || i + 1 == _size) {
+                out.println(line.c_str());
+                line.clear();
+            }
+        }
+    }
+
+  private:
+    uint16_t _packed[N];
+    uint16_t _head = 0, _size = 0;
+    uint32_t _total = 0;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include "reading_stats.hpp"
+
+void RunningStats::reset() {
+    _count = 0;
+    _mean = 0;
+    _m2 = 0;
+    _min = 255;
+    _max = 0;
+}
+
+void RunningStats::add(uint8_t value) {
+    if (_count == UINT16_MAX)
+        return;
+    _count++;
+    _min = value < _min ? value : _min;
+    _max = value > _max ? value : _max;
+
+    int32_t sample = (uint16_t)value << 8;
+    int32_t before = sample - _mean;
+    _mean += before / _count;
+    int32_t after = sample - _mean;
+    // (x - mean_old) * (x - mean_new) >= 0, огрубляем до 1/16, чтобы
+    // произведение поместилось в 32 бита
+    uint32_t term = (uint32_t)((before >> 4) * (after >> 4));
+    _m2 = term > UINT32_MAX - _m2 ? UINT32_MAX : _m2 + term;
+}
+
+uint16_t RunningStats::meanX100() const {
+    return ((uint32_t)_mean * 100 + 128) >> 8;
+}
+
+uint32_t RunningStats::varianceX100() const {
+    if (_count < 2)
+        return 0;
+    // M2 / (n - 1) с 8 дробными битами; x100 делим до умножения, если
+    // иначе не помещается
+    uint32_t variance = _m2 / (_count - 1);
+    return variance < UINT32_MAX / 100 ? (variance * 100 + 128) >> 8
+                                       : (variance >> 8) * 100;
+}
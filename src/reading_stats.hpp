@@ -0,0 +1,33 @@
+#ifndef READING_STATS_HPP
+#define READING_STATS_HPP
+
+#include <Arduino.h>
+
+/*
+    Потоковая статистика одного канала (0-255) по алгоритму Уэлфорда в
+    целых числах, без хранения самих значений.
+    - Среднее хранится с 8 дробными битами, сумма квадратов отклонений
+      M2 - тоже (отклонения перед умножением огрубляются до 1/16)
+    - M2 помещается в 32 бита минимум для ~1000 значений даже при
+      наибольшем разбросе (0 и 255 через раз), дальше насыщается
+*/
+
+class RunningStats {
+  public:
+    void reset();
+    void add(uint8_t value);
+
+    uint16_t count() const { return _count; }
+    uint8_t minimum() const { return _min; }
+    uint8_t maximum() const { return _max; }
+    uint16_t meanX100() const;      // среднее x100
+    uint32_t varianceX100() const;  // выборочная дисперсия x100
+
+  private:
+    uint16_t _count = 0;
+    uint16_t _mean = 0;  // 8 дробных бит
+    uint32_t _m2 = 0;    // 8 дробных бит
+    uint8_t _min = 255, _max = 0;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "serial_batch.hpp"
+
+#include "serial_frame.hpp"
+
+SerialBatch::SerialBatch(Print &out, const char *start, const char *end,
+                         char separator)
+    : _out(out), _start(start), _end(end), _separator(separator) {}
+
+void SerialBatch::configure(uint8_t size, uint16_t deadline,
+                            BatchPolicy policy) {
+    flush();
+    _size = constrain(size, 1, SERIAL_BATCH_CAPACITY);
+    _deadline = deadline;
+    _policy = policy;
+}
+
+void SerialBatch::setFormat(bool binary, uint8_t mode, uint8_t space,
+                            char tag) {
+    if (binary == _binary && mode == _mode && space == _space && tag == _tag)
+        return;
+    flush();
+    _binary = binary;
+    _mode = mode;
+    _space = space;
+    _tag = tag;
+}
+
+void SerialBatch::push(const int16_t values[3], uint8_t sensor) {
+    if (_count == _size) {
+        // Пакет набран, но буфер ещё занят предыдущим
+        if (_policy == BatchLatest) {
+            memmove(_values[0], _values[1], sizeof(_values[0]) * (_count - 1));
+            memmove(_sensors, _sensors + 1, _count - 1);
+            _count--;
+            _dropped++;
+        } else {
+            drain(true);
+            encode();
+        }
+    }
+    if (!_count)
+        _first_at = millis();
+    _sensors[_count] = sensor;
+    memcpy(_values[_count++], values, sizeof(_values[0]));
+    poll();
+}
+
+void SerialBatch::poll() {
+    drain(false);
+    if (_count && _sent == _length &&
+        (_count >= _size || millis() - _first_at >= _deadline))
+        encode();
+    drain(false);
+}
+
+void SerialBatch::flush() {
+    drain(true);
+    if (!_count)
+        return;
+    encode();
+    drain(true);
+}
+
+size_t SerialBatch::write(uint8_t c) {
+    if (_length >= SERIAL_BATCH_BUFFER_SIZE)
+        return 0;
+    _buffer[_length++] = c;
+    return 1;
+}
+
+// Буфер должен быть пуст: кодирует накопленные измерения в него
+void SerialBatch::encode() {
+    _length = _sent = 0;
+    if (_binary) {
+        if (_count > 1)
+            frame_sendBatch(*this, _mode, _space, _values, _sensors, _count);
+        else if (!_space)
+            frame_sendColor(*this, _mode, _values[0][0], _values[0][1],
+                            _values[0][2], _sensors[0]);
+        else
+            for (uint8_t c = 0; c < 3; ++c)
+                frame_sendComponent(*this, _mode, _space, c, _values[0][c],
+                                    _sensors[0]);
+    } else {
+        print(reinterpret_cast<const __FlashStringHelper *>(_start));
+        if (_tag)
+            print(_tag);
+        for (uint8_t i = 0; i < _count; ++i) {
+            if (_sensor_tags) {
+                print(_sensors[i]);
+                print(':');
+            }
+            for (uint8_t c = 0; c < 3; ++c) {
+                if (c)
+                    print(_separator);
+                print(_values[i][c]);
+            }
+            if (i + 1 < _count)
+                print(';');
+        }
+        print(reinterpret_cast<const __FlashStringHelper *>(_end));
+        println();
+    }
+    _count = 0;
+    _batches++;
+}
+
+// Отправить закодированный пакет: целиком (wait) или сколько влезет
+// в буфер передачи
+void SerialBatch::drain(bool wait) {
+    uint8_t left = _length - _sent;
+    if (!left)
+        return;
+    if (!wait) {
+        int space = _out.availableForWrite();
+        if (space <= 0)
+            return;
+        if (left > space)
+            left = space;
+    }
+    _sent += _out.write(_buffer + _sent, left);
+    if (_sent == _length)
+        _length = _sent = 0;
+}
@@ -0,0 +1,85 @@
+#ifndef SERIAL_BATCH_HPP
+#define SERIAL_BATCH_HPP
+
+#include <Arduino.h>
+
+/*
+    Выходная очередь измерений для Serial.
+    - Измерения копятся в пакет до size штук или до истечения deadline
+      (мс) с первого из них, затем пакет кодируется в собственный буфер
+      (текст $#$a,b,c;a,b,c@!@ или кадры serial_frame.hpp) и уходит
+      в Serial по мере свободного места в буфере передачи, loop() при
+      этом не ждёт
+    - Если пакет набран, а предыдущий ещё не ушёл:
+        BatchQueue  - ждём отправки (как прямой Serial.print), ничего не
+                      теряется
+        BatchLatest - выбрасываем самое старое измерение пакета, чтобы
+                      не тормозить измерения; счётчик dropped()
+    - Любой другой вывод в тот же Serial нужно начинать с flush(),
+      иначе он вклинится в середину пакета
+    - Каждое измерение помечено номером датчика. В двоичных кадрах он
+      есть всегда, в тексте - только после setSensorTags(true):
+      $#$0:a,b,c;1:a,b,c@!@
+*/
+
+// Наибольшее количество измерений в пакете
+const uint8_t SERIAL_BATCH_CAPACITY = 4;
+// Буфер закодированного пакета: самый длинный текстовый пакет
+// "$#$L3:-1280,-12800,-12800;...@!@\r\n" из SERIAL_BATCH_CAPACITY измерений
+const uint8_t SERIAL_BATCH_BUFFER_SIZE = 96;
+
+enum BatchPolicy : uint8_t { BatchQueue = 0, BatchLatest };
+
+class SerialBatch : public Print {
+  public:
+    // start, end - границы текстового пакета в PROGMEM
+    SerialBatch(Print &out, const char *start, const char *end,
+                char separator);
+
+    void configure(uint8_t size, uint16_t deadline, BatchPolicy policy);
+    // Формат следующих измерений: если он отличается, накопленное
+    // сначала уходит целиком. tag - буква пространства для текста (0 - нет)
+    void setFormat(bool binary, uint8_t mode, uint8_t space, char tag);
+    // Писать ли номер датчика в текстовых пакетах
+    void setSensorTags(bool enable) { _sensor_tags = enable; }
+    void push(const int16_t values[3], uint8_t sensor = 0);
+    void poll();   // вызывать из loop()
+    void flush();  // отправить всё накопленное, дождавшись Serial
+
+    uint8_t size() const { return _size; }
+    uint16_t deadline() const { return _deadline; }
+    BatchPolicy policy() const { return _policy; }
+    // Всё отправлено и ничего не ждёт срока пакета
+    boolean isIdle() const { return !_count && _sent == _length; }
+    uint16_t dropped() const { return _dropped; }
+    uint32_t batches() const { return _batches; }
+
+    // Запись в буфер пакета, для print() и функций serial_frame
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+  private:
+    void encode();
+    void drain(bool wait);
+
+    Print &_out;
+    const char *_start, *_end;
+    char _separator;
+    uint8_t _size = 1;
+    uint16_t _deadline = 0;
+    BatchPolicy _policy = BatchQueue;
+    bool _binary = false;
+    uint8_t _mode = 0, _space = 0;
+    char _tag = 0;
+    bool _sensor_tags = false;
+    int16_t _values[SERIAL_BATCH_CAPACITY][3];
+    uint8_t _sensors[SERIAL_BATCH_CAPACITY];
+    uint8_t _count = 0;
+    uint32_t _first_at = 0;
+    uint8_t _buffer[SERIAL_BATCH_BUFFER_SIZE];
+    uint8_t _length = 0, _sent = 0;
+    uint16_t _dropped = 0;
+    uint32_t _batches = 0;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "serial_command.hpp"
+
+boolean CommandParser::feed(char c) {
+    if (_complete) {
+        // Предыдущая команда уже выполнена, начинаем новую
+        _command = 0;
+        _count = 0;
+        _error = false;
+        _complete = false;
+    }
+    if (c == '\n' || c == '\r') {
+        // Пустые строки (и '\n' после '\r') пропускаются
+        if (!_command)
+            return false;
+        endNumber();
+        _complete = true;
+        return true;
+    }
+    if (!_command) {
+        if (c == ' ' || c == '\t')
+            return false;
+        if (c >= 'a' && c <= 'z')
+            c -= 'a' - 'A';
+        _command = c;
+        _error = c < 'A' || c > 'Z';
+        return false;
+    }
+    if (c == ' ' || c == '\t' || c == ',') {
+        endNumber();
+        return false;
+    }
+    if (c == '-' && !_in_number) {
+        _in_number = _negative = true;
+        return false;
+    }
+    if (c < '0' || c > '9') {
+        _error = true;
+        return false;
+    }
+    // Больше 9 знаков int32 может не вместить
+    if (_value >= 100000000UL) {
+        _error = true;
+        return false;
+    }
+    _value = _value * 10 + (c - '0');
+    _in_number = _has_digits = true;
+    return false;
+}
+
+// Закончить текущее число и записать его в аргументы
+void CommandParser::endNumber() {
+    if (!_in_number)
+        return;
+    // Один знак без цифр ("D -") - не число
+    if (!_has_digits)
+        _error = true;
+    else if (_count < SERIAL_COMMAND_MAX_ARGS)
+        _args[_count++] = _negative ? -(int32_t)_value : (int32_t)_value;
+    else
+        _error = true;
+    _value = 0;
+    _in_number = _negative = _has_digits = false;
+}
@@ -0,0 +1,45 @@
+#ifndef SERIAL_COMMAND_HPP
+#define SERIAL_COMMAND_HPP
+
+#include <Arduino.h>
+
+/*
+    Разбор текстовых команд из Serial без буфера строки и без String.
+    - Команда - одна строка: буква и до SERIAL_COMMAND_MAX_ARGS целых
+      аргументов через пробел или запятую, в конце '\n' (или '\r'),
+      например "O 64 5 13"
+    - Байты подаются по одному по мере прихода (feed), числа собираются
+      сразу, так что loop() никогда не ждёт конца строки
+    - Лишние аргументы, посторонние символы, знак без цифр и числа вне
+      int32 помечают команду ошибочной, она всё равно дочитывается до
+      конца строки, чтобы следующая строка разбиралась с начала
+*/
+
+// Наибольшее количество аргументов команды
+const uint8_t SERIAL_COMMAND_MAX_ARGS = 4;
+
+class CommandParser {
+  public:
+    // Принять очередной байт. true - строка с командой принята целиком
+    boolean feed(char c);
+
+    char command() const { return _command; }  // буква, заглавная
+    boolean valid() const { return !_error; }
+    uint8_t argCount() const { return _count; }
+    // Аргумент с номером i или fallback, если его не передали
+    int32_t arg(uint8_t i, int32_t fallback = 0) const {
+        return i < _count ? _args[i] : fallback;
+    }
+
+  private:
+    void endNumber();
+
+    char _command = 0;
+    int32_t _args[SERIAL_COMMAND_MAX_ARGS];
+    uint8_t _count = 0;
+    uint32_t _value = 0;
+    boolean _in_number = false, _negative = false, _has_digits = false,
+            _error = false, _complete = false;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "serial_frame.hpp"
+
+static uint8_t frame_sequence = 0;
+
+uint8_t crc8(const uint8_t *data, uint8_t length) {
+    return crc8_update(0, data, length);
+}
+
+uint8_t crc8_update(uint8_t crc, const uint8_t *data, uint8_t length) {
+    while (length--) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; ++bit)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static void frame_send(Print &out, FrameType type, uint8_t mode,
+                       const uint8_t payload[FRAME_PAYLOAD_SIZE]) {
+    uint8_t frame[FRAME_SIZE];
+    frame[0] = FRAME_SYNC;
+    frame[1] = frame_sequence++;
+    frame[2] = (type << 4) | (mode & 0x0F);
+    for (uint8_t i = 0; i < FRAME_PAYLOAD_SIZE; ++i)
+        frame[3 + i] = payload[i];
+    frame[FRAME_SIZE - 1] = crc8(frame, FRAME_SIZE - 1);
+    out.write(frame, FRAME_SIZE);
+}
+
+void frame_sendColor(Print &out, uint8_t mode, uint8_t r, uint8_t g, uint8_t b,
+                     uint8_t sensor) {
+    const uint8_t payload[FRAME_PAYLOAD_SIZE] = {r, g, b, sensor};
+    frame_send(out, ColorFrame, mode, payload);
+}
+
+void frame_sendRawLevels(Print &out, uint8_t mode, const uint16_t levels[3],
+                         uint8_t sensor) {
+    uint32_t packed = (uint32_t)(levels[0] & 0x3FF) |
+                      ((uint32_t)(levels[1] & 0x3FF) << 10) |
+                      ((uint32_t)(levels[2] & 0x3FF) << 20) |
+                      ((uint32_t)(sensor & 0x03) << 30);
+    const uint8_t payload[FRAME_PAYLOAD_SIZE] = {
+        (uint8_t)packed, (uint8_t)(packed >> 8), (uint8_t)(packed >> 16),
+        (uint8_t)(packed >> 24)};
+    frame_send(out, RawLevelsFrame, mode, payload);
+}
+
+void frame_sendLevel(Print &out, uint8_t mode, uint8_t channel, uint8_t bits,
+                     uint16_t level, uint8_t sensor) {
+    const uint8_t payload[FRAME_PAYLOAD_SIZE] = {
+        (uint8_t)((sensor << 4) | (channel & 0x0F)), bits, (uint8_t)level,
+        (uint8_t)(level >> 8)};
+    frame_send(out, LevelFrame, mode, payload);
+}
+
+void frame_sendSamples(Print &out, uint8_t mode, uint8_t channel,
+                       uint16_t count, uint8_t sensor) {
+    const uint8_t payload[FRAME_PAYLOAD_SIZE] = {
+        (uint8_t)((sensor << 4) | (channel & 0x0F)), 0, (uint8_t)count,
+        (uint8_t)(count >> 8)};
+    frame_send(out, SamplesFrame, mode, payload);
+}
+
+void frame_sendComponent(Print &out, uint8_t mode, uint8_t space,
+                         uint8_t component, int16_t value, uint8_t sensor) {
+    const uint8_t payload[FRAME_PAYLOAD_SIZE] = {
+        space, (uint8_t)((sensor << 4) | (component & 0x0F)), (uint8_t)value,
+        (uint8_t)((uint16_t)value >> 8)};
+    frame_send(out, ComponentFrame, mode, payload);
+}
+
+void frame_sendBatch(Print &out, uint8_t mode, uint8_t space,
+                     const int16_t values[][3], const uint8_t sensors[],
+                     uint8_t count) {
+    // CRC считается по ходу записи, кадр целиком в памяти не нужен
+    uint8_t header[FRAME_BATCH_OVERHEAD - 1] = {
+        FRAME_SYNC, frame_sequence++,
+        (uint8_t)((BatchFrame << 4) | (mode & 0x0F)), space, count};
+    uint8_t crc = crc8(header, sizeof(header));
+    out.write(header, sizeof(header));
+    for (uint8_t i = 0; i < count; ++i) {
+        out.write(sensors[i]);
+        crc = crc8_update(crc, &sensors[i], 1);
+        for (uint8_t c = 0; c < 3; ++c) {
+            uint8_t bytes[2] = {(uint8_t)values[i][c],
+                                (uint8_t)((uint16_t)values[i][c] >> 8)};
+            out.write(bytes, 2);
+            crc = crc8_update(crc, bytes, 2);
+        }
+    }
+    out.write(crc);
+}
+
+void frame_sendMode(Print &out, uint8_t mode) {
+    const uint8_t payload[FRAME_PAYLOAD_SIZE] = {0, 0, 0, 0};
+    frame_send(out, ModeFrame, mode, payload);
+}
@@ -0,0 +1,87 @@
+#ifndef SERIAL_FRAME_HPP
+#define SERIAL_FRAME_HPP
+
+#include <Arduino.h>
+
+/*
+    Двоичный протокол передачи данных через Serial.
+    Кадр фиксированной длины FRAME_SIZE байт, собирается на стеке:
+
+      [0]    FRAME_SYNC
+      [1]    порядковый номер кадра (0-255, по кругу)
+      [2]    тип кадра (старшие 4 бита) | режим работы (младшие 4 бита)
+      [3..6] полезная нагрузка:
+               ColorFrame     - R, G, B, номер датчика
+               RawLevelsFrame - три 10-битных уровня АЦП, упакованные
+                                подряд начиная с младшего бита (30 бит),
+                                в старших 2 битах - номер датчика
+               ModeFrame      - нули
+               LevelFrame     - номер датчика (старшие 4 бита) | номер
+                                цвета, разрядность уровня (10-16),
+                                уровень (16 бит, младший байт первым)
+               ComponentFrame - цветовое пространство (см. color_space.hpp),
+                                номер датчика (старшие 4 бита) | номер
+                                компоненты, значение (16 бит со знаком,
+                                младший байт первым)
+               SamplesFrame   - номер датчика (старшие 4 бита) | номер
+                                цвета, 0, сколько выборок АЦП вошло
+                                в уровень (16 бит, младший байт первым)
+      [7]    CRC-8 (полином 0x07, начальное значение 0) байтов 0..6
+
+    С одним датчиком (номер 0) кадры такие же, как были до поддержки
+    нескольких датчиков.
+
+    Исключение - пакет из нескольких измерений BatchFrame переменной длины
+    FRAME_BATCH_OVERHEAD + FRAME_BATCH_ENTRY_SIZE * n байт:
+
+      [0..2] как у обычного кадра
+      [3]    цветовое пространство (см. color_space.hpp)
+      [4]    n - количество измерений
+      [5..]  на измерение: номер датчика и три компоненты, 16 бит со
+             знаком, младший байт первым
+      [...]  CRC-8 всех предыдущих байтов
+*/
+
+// Байт синхронизации, начало кадра
+const uint8_t FRAME_SYNC = 0xA5;
+// Длина кадра в байтах
+const uint8_t FRAME_SIZE = 8;
+// Длина полезной нагрузки в байтах
+const uint8_t FRAME_PAYLOAD_SIZE = 4;
+// Длина BatchFrame без измерений
+const uint8_t FRAME_BATCH_OVERHEAD = 6;
+// Длина одного измерения в BatchFrame
+const uint8_t FRAME_BATCH_ENTRY_SIZE = 7;
+
+// Типы кадров
+enum FrameType {
+    ColorFrame = 1,
+    RawLevelsFrame,
+    ModeFrame,
+    LevelFrame,
+    ComponentFrame,
+    BatchFrame,
+    SamplesFrame
+};
+
+uint8_t crc8(const uint8_t *data, uint8_t length);
+// Продолжить CRC-8 с уже посчитанного значения
+uint8_t crc8_update(uint8_t crc, const uint8_t *data, uint8_t length);
+
+void frame_sendColor(Print &out, uint8_t mode, uint8_t r, uint8_t g, uint8_t b,
+                     uint8_t sensor = 0);
+void frame_sendRawLevels(Print &out, uint8_t mode, const uint16_t levels[3],
+                         uint8_t sensor = 0);
+void frame_sendMode(Print &out, uint8_t mode);
+void frame_sendComponent(Print &out, uint8_t mode, uint8_t space,
+                         uint8_t component, int16_t value, uint8_t sensor = 0);
+// sensors - номер датчика каждого измерения
+void frame_sendBatch(Print &out, uint8_t mode, uint8_t space,
+                     const int16_t values[][3], const uint8_t sensors[],
+                     uint8_t count);
+void frame_sendLevel(Print &out, uint8_t mode, uint8_t channel, uint8_t bits,
+                     uint16_t level, uint8_t sensor = 0);
+void frame_sendSamples(Print &out, uint8_t mode, uint8_t channel,
+                       uint16_t count, uint8_t sensor = 0);
+
+#endif
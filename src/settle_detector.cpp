@@ -0,0 +1,78 @@
+#include "settle_detector.hpp"
+
+#include "adc_sampler.hpp"
+
+SettleDetector::SettleDetector(uint16_t min_delay, uint16_t timeout,
+                               uint8_t threshold, uint8_t stable_windows)
+    : _min_delay(min_delay),
+      _timeout(timeout),
+      _threshold(threshold),
+      _stable_windows(stable_windows) {}
+
+void SettleDetector::setMinDelay(uint16_t ms) { _min_delay = ms; }
+
+void SettleDetector::setTimeout(uint16_t ms) { _timeout = ms; }
+
+void SettleDetector::setThreshold(uint8_t level) { _threshold = level; }
+
+void SettleDetector::setStableWindows(uint8_t count) {
+    _stable_windows = count;
+}
+
+uint16_t SettleDetector::minDelay() { return _min_delay; }
+
+uint8_t SettleDetector::threshold() { return _threshold; }
+
+uint8_t SettleDetector::stableWindows() { return _stable_windows; }
+
+void SettleDetector::start() { start(millis()); }
+
+// Задержка и таймаут отсчитываются от since: пока АЦП был занят другим
+// датчиком, сигнал уже устанавливался
+void SettleDetector::start(uint32_t since) {
+    _started = since;
+    _window_samples = SETTLE_WINDOW_SAMPLES -
+                      SETTLE_WINDOW_SAMPLES % adc_channels();
+    _window_sum = 0;
+    _window_count = 0;
+    _stable_count = 0;
+    _has_previous = false;
+    _timed_out = false;
+    adc_start();
+}
+
+boolean SettleDetector::isSettled() {
+    uint16_t elapsed = millis() - _started;
+    if (elapsed >= _timeout) {
+        _timed_out = true;
+        _settle_time = elapsed;
+        return true;
+    }
+    _window_count += adc_readBlock(_window_sum,
+                                   _window_samples - _window_count);
+    if (_window_count < _window_samples)
+        return false;
+
+    // Сравниваем суммы, а не средние, чтобы обойтись без деления
+    uint32_t delta = _window_sum > _previous_sum ? _window_sum - _previous_sum
+                                                 : _previous_sum - _window_sum;
+    boolean stable = _has_previous &&
+                     delta <= (uint32_t)_threshold * _window_samples;
+    _previous_sum = _window_sum;
+    _has_previous = true;
+    _window_sum = 0;
+    _window_count = 0;
+
+    if (elapsed < _min_delay || !stable) {
+        _stable_count = 0;
+        return false;
+    }
+    if (++_stable_count < _stable_windows)
+        return false;
+    _settle_time = elapsed;
+    return true;
+}
+
+uint16_t SettleDetector::settleTime() { return _settle_time; }
+
+boolean SettleDetector::timedOut() { return _timed_out; }
@@ -0,0 +1,53 @@
+#ifndef SETTLE_DETECTOR_HPP
+#define SETTLE_DETECTOR_HPP
+
+#include <Arduino.h>
+
+/*
+    Определение момента установления сигнала фоторезистора после
+    включения светодиода.
+    - Выборки АЦП (см. adc_sampler.hpp) усредняются окнами по
+      SETTLE_WINDOW_SAMPLES штук. При нескольких входах АЦП окно
+      укорачивается до кратного их количеству, чтобы в каждом окне было
+      поровну выборок всех датчиков
+    - Сигнал считается установившимся, когда средние соседних окон
+      отличаются не больше чем на порог (ед. АЦП) несколько окон подряд
+    - Раньше минимальной задержки проверка не начинается (фоторезистор
+      реагирует не сразу), позже таймаута - ожидание прекращается в любом
+      случае
+*/
+
+// Количество выборок в одном окне усреднения (~3.3 мс)
+const uint8_t SETTLE_WINDOW_SAMPLES = 32;
+
+class SettleDetector {
+  public:
+    SettleDetector(uint16_t min_delay, uint16_t timeout, uint8_t threshold,
+                   uint8_t stable_windows);
+
+    void setMinDelay(uint16_t ms);          // не проверять раньше, мс
+    void setTimeout(uint16_t ms);           // ждать не дольше, мс
+    void setThreshold(uint8_t level);       // допустимое изменение среднего за окно
+    void setStableWindows(uint8_t count);   // сколько окон подряд должны совпасть
+    uint16_t minDelay();
+    uint8_t threshold();
+    uint8_t stableWindows();
+
+    void start();           // светодиод только что переключён, запускает АЦП
+    void start(uint32_t since);  // светодиод переключён в момент since (millis())
+    boolean isSettled();    // забирает выборки, true - можно считывать
+    uint16_t settleTime();  // время установления (мс) последнего ожидания
+    boolean timedOut();     // последнее ожидание закончилось по таймауту
+
+  private:
+    uint16_t _min_delay, _timeout;
+    uint8_t _threshold, _stable_windows;
+    uint32_t _started = 0;
+    uint32_t _window_sum = 0, _previous_sum = 0;
+    uint8_t _window_samples = SETTLE_WINDOW_SAMPLES;
+    uint8_t _window_count = 0, _stable_count = 0;
+    boolean _has_previous = false, _timed_out = false;
+    uint16_t _settle_time = 0;
+};
+
+#endif
@@ -0,0 +1,19 @@
+#include "text_format.hpp"
+
+void fmt_hex8(char *out, uint8_t value) {
+    static const char digits[] PROGMEM = "0123456789ABCDEF";
+    out[0] = pgm_read_byte(&digits[value >> 4]);
+    out[1] = pgm_read_byte(&digits[value & 0x0F]);
+}
+
+uint8_t fmt_dec(char *out, uint32_t value) {
+    char reversed[FMT_DEC_MAX_LENGTH];
+    uint8_t length = 0;
+    do {
+        reversed[length++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    for (uint8_t i = 0; i < length; ++i)
+        out[i] = reversed[length - 1 - i];
+    return length;
+}
@@ -0,0 +1,92 @@
+#ifndef TEXT_FORMAT_HPP
+#define TEXT_FORMAT_HPP
+
+#include <Arduino.h>
+
+/*
+    Форматирование текста без динамической памяти.
+    - Все строки собираются в буферах фиксированного размера на стеке
+    - Размеры результатов известны при компиляции: байт в HEX - ровно
+      FMT_HEX8_LENGTH символа, число в DEC - не больше FMT_DEC_MAX_LENGTH
+    - Постоянные строки лежат во flash (PROGMEM), выводятся через FLASH_STR()
+*/
+
+// Приведение строки из PROGMEM к типу, который понимает Print::print()
+#define FLASH_STR(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+// Количество символов байта в шестнадцатеричном виде
+const uint8_t FMT_HEX8_LENGTH = 2;
+// Максимальное количество символов uint32_t в десятичном виде
+const uint8_t FMT_DEC_MAX_LENGTH = 10;
+
+// Записывает байт в виде двух шестнадцатеричных цифр (заглавных)
+void fmt_hex8(char *out, uint8_t value);
+// Записывает число в десятичном виде без завершающего нуля, возвращает длину
+uint8_t fmt_dec(char *out, uint32_t value);
+
+// Строка фиксированной вместимости N символов, не выделяет память.
+// Всё, что не поместилось, молча отбрасывается
+template <uint8_t N>
+class TextBuffer {
+  public:
+    TextBuffer() { clear(); }
+
+    void clear() {
+        _length = 0;
+        _data[0] = 0;
+    }
+
+    TextBuffer &add(char c) {
+        if (_length < N) {
+            _data[_length++] = c;
+            _data[_length] = 0;
+        }
+        return *this;
+    }
+
+    TextBuffer &add(const char *s) {
+        while (*s)
+            add(*s++);
+        return *this;
+    }
+
+    TextBuffer &add(const __FlashStringHelper *s) {
+        const char *p = reinterpret_cast<const char *>(s);
+        char c;
+        while ((c = pgm_read_byte(p++)) != 0)
+            add(c);
+        return *this;
+    }
+
+    TextBuffer &addDec(uint32_t value) {
+        char digits[FMT_DEC_MAX_LENGTH];
+        uint8_t count = fmt_dec(digits, value);
+        for (uint8_t i = 0; i < count; ++i)
+            add(digits[i]);
+        return *this;
+    }
+
+    TextBuffer &addInt(int32_t value) {
+        if (value < 0) {
+            add('-');
+            return addDec(-(uint32_t)value);
+        }
+        return addDec(value);
+    }
+
+    TextBuffer &addHex(uint8_t value) {
+        char digits[FMT_HEX8_LENGTH];
+        fmt_hex8(digits, value);
+        return add(digits[0]).add(digits[1]);
+    }
+
+    const char *c_str() const { return _data; }
+    uint8_t length() const { return _length; }
+    static uint8_t capacity() { return N; }
+
+  private:
+    char _data[N + 1];
+    uint8_t _length;
+};
+
+#endif
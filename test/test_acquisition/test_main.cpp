@@ -0,0 +1,300 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <time.h>
+#include <unity.h>
+
+#include "acquisition.hpp"
+#include "sim.h"
+
+/*
+    Последовательность измерения по таблице фаз на модели фоторезистора:
+    три цветные фазы и та же таблица с белым и ИК светодиодами. В конце -
+    стоимость измерения: проходы tick() и время процессора ПК на фазу для
+    3 и 5 фаз (код один, растут только таблица и массивы уровней) и
+    против прежнего readColor() со switch по цветам
+*/
+
+const uint8_t WHITE_LED_PIN = 12;
+const uint8_t IR_LED_PIN = 13;
+
+constexpr AcquisitionPhase RGB_PHASES[] PROGMEM = {
+    {6, 200, 256, 0}, {7, 200, 256, 1}, {8, 200, 256, 2}};
+
+constexpr AcquisitionPhase RGBWI_PHASES[] PROGMEM = {
+    {6, 200, 256, 0},
+    {7, 200, 256, 1},
+    {8, 200, 256, 2},
+    {WHITE_LED_PIN, 200, 256, 3},
+    {IR_LED_PIN, 200, 256, 4}};
+
+static SettleDetector settle(20, 200, 1, 3);
+static AcquisitionSequencer<3> rgb(RGB_PHASES, settle);
+static AcquisitionSequencer<5> rgbwi(RGBWI_PHASES, settle);
+
+// Проходы tick() до конца измерения, по 100 мкс виртуального времени
+template <uint8_t N>
+static uint32_t acquire(AcquisitionSequencer<N> &sequencer,
+                        uint8_t first = 0, uint8_t count = N) {
+    uint32_t passes = 0;
+    sequencer.start(first, count);
+    while (!sequencer.tick()) {
+        sim_advance(100);
+        passes++;
+        if (passes > 100000)
+            break;
+    }
+    return passes;
+}
+
+void setUp() {
+    sim_setColor(200, 30, 30);
+    sim_setNoise(1);
+}
+
+void tearDown() {}
+
+void test_levels_follow_reflectance() {
+    acquire(rgb);
+    // Больше отражённого света - меньше уровень
+    TEST_ASSERT_LESS_THAN(rgb.level(1) - 100, rgb.level(0));
+    TEST_ASSERT_UINT_WITHIN(2, rgb.level(1), rgb.level(2));
+    for (uint8_t i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL_UINT8(i, rgb.slot(i));
+        TEST_ASSERT_EQUAL_UINT16(256, rgb.samplesUsed(i));
+    }
+}
+
+void test_extra_phases_fill_their_slots() {
+    acquire(rgbwi);
+    // Белый видит среднее отражение, ИК светит вдвое слабее
+    TEST_ASSERT_LESS_THAN(rgbwi.level(1), rgbwi.level(3));
+    TEST_ASSERT_GREATER_THAN(rgbwi.level(0), rgbwi.level(3));
+    TEST_ASSERT_GREATER_THAN(rgbwi.level(3), rgbwi.level(4));
+    TEST_ASSERT_UINT_WITHIN(2, rgb.level(0), rgbwi.level(0));
+    TEST_ASSERT_EQUAL_UINT8(4, rgbwi.slot(4));
+    TEST_ASSERT_EQUAL_UINT8(5, rgbwi.channels());
+}
+
+void test_leds_are_off_after_reading() {
+    acquire(rgbwi);
+    double lit = sim_ledOnSeconds();
+    sim_advance(100000);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, lit, sim_ledOnSeconds());
+}
+
+void test_partial_start_keeps_other_levels() {
+    acquire(rgbwi);
+    uint16_t red = rgbwi.level(0);
+    sim_setColor(30, 200, 30);
+    acquire(rgbwi, 3, 1);
+    TEST_ASSERT_EQUAL_UINT16(red, rgbwi.level(0));
+    acquire(rgbwi, 0, 1);
+    TEST_ASSERT_GREATER_THAN(red + 100, rgbwi.level(0));
+}
+
+// Отмена посреди пакета: adc_stop() забывает пакет, новое измерение
+// набирает полный
+void test_cancel_clears_burst() {
+    rgb.start();
+    for (uint32_t passes = 0; rgb.isWaiting() && passes < 100000; ++passes) {
+        rgb.tick();
+        sim_advance(100);
+    }
+    for (uint8_t i = 0; i < 50; ++i) {
+        rgb.tick();
+        sim_advance(100);
+    }
+    TEST_ASSERT_FALSE(adc_burstReady());
+    rgb.cancel();
+    TEST_ASSERT_TRUE(adc_burstReady());
+    TEST_ASSERT_EQUAL_UINT16(0, adc_burstCount());
+    TEST_ASSERT_EQUAL_UINT32(0, adc_burstSum());
+    acquire(rgb);
+    for (uint8_t i = 0; i < 3; ++i)
+        TEST_ASSERT_EQUAL_UINT16(256, rgb.samplesUsed(i));
+}
+
+// Стоимость фазы не зависит от количества фаз
+void test_cost_per_phase() {
+    const uint8_t READINGS = 20;
+    uint32_t passes[2] = {};
+    double cpu_us[2] = {};
+    for (uint8_t table = 0; table < 2; ++table) {
+        clock_t started = clock();
+        for (uint8_t i = 0; i < READINGS; ++i)
+            passes[table] += table ? acquire(rgbwi) : acquire(rgb);
+        cpu_us[table] = (clock() - started) * 1e6 / CLOCKS_PER_SEC;
+    }
+    char message[160];
+    snprintf(message, sizeof(message),
+             "per phase: 3 phases %lu passes %.1f us CPU, "
+             "5 phases %lu passes %.1f us CPU; RAM %u vs %u bytes",
+             (unsigned long)(passes[0] / (READINGS * 3)),
+             cpu_us[0] / (READINGS * 3),
+             (unsigned long)(passes[1] / (READINGS * 5)),
+             cpu_us[1] / (READINGS * 5), (unsigned)sizeof(rgb),
+             (unsigned)sizeof(rgbwi));
+    TEST_MESSAGE(message);
+    uint32_t rgb_phase = passes[0] / (READINGS * 3);
+    uint32_t rgbwi_phase = passes[1] / (READINGS * 5);
+    TEST_ASSERT_UINT_WITHIN(rgb_phase / 10, rgb_phase, rgbwi_phase);
+}
+
+// Прежний readColor() до таблицы фаз, без отладочного вывода и перевода
+// уровней в цвет: свой case ожидания и считывания на каждый цвет, выборки
+// по одной из кольцевого буфера АЦП
+enum ReadingColorState {
+    NotStarted = 0,
+    WaitingRed,
+    ReadingRed,
+    WaitingGreen,
+    ReadingGreen,
+    WaitingBlue,
+    ReadingBlue
+};
+enum Color { Red = 0, Green, Blue };
+
+const uint16_t CONSECUTIVE_READINGS_COUNT = 256;
+constexpr uint8_t ledPins[] = {6, 7, 8};
+
+static ReadingColorState reading_state = NotStarted;
+static uint32_t level_sum;
+static uint16_t read_repeats_left;
+static uint16_t current_levels[3];
+static uint16_t settle_times[3];
+
+static void enable_led(Color color) { digitalWrite(ledPins[color], 1); }
+
+static void disable_led(Color color) { digitalWrite(ledPins[color], 0); }
+
+static void startColorLevel() {
+    level_sum = 0;
+    read_repeats_left = CONSECUTIVE_READINGS_COUNT;
+    adc_start();
+}
+
+static void readColorLevel(Color color) {
+    uint16_t taken = adc_readBlock(level_sum, read_repeats_left);
+    read_repeats_left -= taken;
+    if (!read_repeats_left)
+        adc_stop();
+}
+
+static bool readColor() {
+    switch (reading_state) {
+        case NotStarted:
+            reading_state = WaitingRed;
+            enable_led(Red);
+            settle.start();
+            return false;
+            break;
+        case WaitingRed:
+            if (settle.isSettled()) {
+                settle_times[Red] = settle.settleTime();
+                reading_state = ReadingRed;
+                startColorLevel();
+            }
+            return false;
+            break;
+        case ReadingRed:
+            readColorLevel(Red);
+            if (!read_repeats_left) {
+                current_levels[Red] = level_sum / CONSECUTIVE_READINGS_COUNT;
+                reading_state = WaitingGreen;
+                disable_led(Red);
+                enable_led(Green);
+                settle.start();
+            }
+            return false;
+            break;
+        case WaitingGreen:
+            if (settle.isSettled()) {
+                settle_times[Green] = settle.settleTime();
+                reading_state = ReadingGreen;
+                startColorLevel();
+            }
+            return false;
+            break;
+        case ReadingGreen:
+            readColorLevel(Green);
+            if (!read_repeats_left) {
+                current_levels[Green] = level_sum / CONSECUTIVE_READINGS_COUNT;
+                reading_state = WaitingBlue;
+                disable_led(Green);
+                enable_led(Blue);
+                settle.start();
+            }
+            return false;
+            break;
+        case WaitingBlue:
+            if (settle.isSettled()) {
+                settle_times[Blue] = settle.settleTime();
+                reading_state = ReadingBlue;
+                startColorLevel();
+            }
+            return false;
+            break;
+        case ReadingBlue:
+            readColorLevel(Blue);
+            if (!read_repeats_left) {
+                current_levels[Blue] = level_sum / CONSECUTIVE_READINGS_COUNT;
+                disable_led(Blue);
+                reading_state = NotStarted;
+            } else {
+                return false;
+            }
+            break;
+    }
+    return true;
+}
+
+// Таблица фаз против прежнего switch: те же уровни, проходы и время ПК на
+// измерение. Размер кода на ПК - nm -S по объектным файлам, флеш AVR
+// здесь не измерить
+void test_cost_against_switch() {
+    const uint8_t READINGS = 20;
+    uint32_t passes[2] = {};
+    double cpu_us[2] = {};
+    for (uint8_t variant = 0; variant < 2; ++variant) {
+        clock_t started = clock();
+        for (uint8_t i = 0; i < READINGS; ++i) {
+            if (variant) {
+                passes[variant] += acquire(rgb);
+                continue;
+            }
+            while (!readColor()) {
+                sim_advance(100);
+                passes[variant]++;
+            }
+        }
+        cpu_us[variant] = (clock() - started) * 1e6 / CLOCKS_PER_SEC;
+    }
+    char message[160];
+    snprintf(message, sizeof(message),
+             "per reading: switch %lu passes %.1f us CPU, "
+             "phase table %lu passes %.1f us CPU",
+             (unsigned long)(passes[0] / READINGS), cpu_us[0] / READINGS,
+             (unsigned long)(passes[1] / READINGS), cpu_us[1] / READINGS);
+    TEST_MESSAGE(message);
+    for (uint8_t i = 0; i < 3; ++i)
+        TEST_ASSERT_UINT_WITHIN(2, current_levels[i], rgb.level(i));
+    // Сумма в прерывании не медленнее выборок по одной
+    TEST_ASSERT_LESS_OR_EQUAL(passes[0], passes[1]);
+}
+
+int main() {
+    sim_setLed(3, WHITE_LED_PIN, 800);
+    sim_setLed(7, IR_LED_PIN, 400);
+    adc_begin(A0);
+    rgb.begin();
+    rgbwi.begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_levels_follow_reflectance);
+    RUN_TEST(test_extra_phases_fill_their_slots);
+    RUN_TEST(test_leds_are_off_after_reading);
+    RUN_TEST(test_partial_start_keeps_other_levels);
+    RUN_TEST(test_cancel_clears_burst);
+    RUN_TEST(test_cost_per_phase);
+    RUN_TEST(test_cost_against_switch);
+    return UNITY_END();
+}
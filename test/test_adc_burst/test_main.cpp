@@ -0,0 +1,207 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <unity.h>
+
+#include "adc_sampler.hpp"
+
+/*
+    adc_burstConfident() в 32 битах против точного 64-битного условия
+    1024 * (n * sum(d^2) - sum(d)^2) <= tolerance^2 * n^2 * (n - 1) на
+    пакетах, подложенных через adc_stubPush(), и кольцевой буфер выборок:
+    переход через конец буфера, переполнение и чтение блоками
+*/
+
+static uint32_t random_state = 0x2545F491;
+
+static uint32_t nextRandom() {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+// Набрать пакет и посчитать точное условие по тем же выборкам
+static bool burst(uint16_t count, uint16_t reference, int8_t offset,
+                  uint8_t noise, uint8_t tolerance) {
+    adc_startBurst(count, true);
+    int64_t sum = 0, squares = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+        int32_t sample = reference;
+        if (i)
+            sample += offset + (noise ? (int32_t)(nextRandom() %
+                                                  (2 * noise + 1)) -
+                                            noise
+                                      : 0);
+        sample = constrain(sample, 0, 1023);
+        adc_stubPush(sample);
+        int64_t deviation = sample - reference;
+        sum += deviation;
+        squares += deviation * deviation;
+    }
+    uint8_t limited = min(tolerance, ADC_MAX_TOLERANCE_X16);
+    return 1024 * (count * squares - sum * sum) <=
+           (int64_t)limited * limited * count * count * (count - 1);
+}
+
+void setUp() { adc_begin(A0); }
+
+void tearDown() { adc_stop(); }
+
+void test_matches_exact_condition() {
+    uint32_t confident = 0;
+    for (uint16_t i = 0; i < 20000; ++i) {
+        uint16_t count = 2 + nextRandom() % (i % 4 ? 300 : 4000);
+        uint16_t reference = nextRandom() % 1024;
+        int8_t offset = (int8_t)(nextRandom() % 7) - 3;
+        uint8_t noise = nextRandom() % (i % 5 ? 4 : 40);
+        uint8_t tolerance = nextRandom() % 70;
+        bool expected = burst(count, reference, offset, noise, tolerance);
+        char message[96];
+        snprintf(message, sizeof(message), "n %u ref %u noise %u tol %u",
+                 count, reference, noise, tolerance);
+        TEST_ASSERT_EQUAL_MESSAGE(expected,
+                                  adc_burstConfident(0, tolerance, 2),
+                                  message);
+        confident += expected;
+    }
+    // Проверены обе ветви
+    TEST_ASSERT_GREATER_THAN(1000, confident);
+    TEST_ASSERT_LESS_THAN(19000, confident);
+}
+
+void test_long_bursts() {
+    for (uint8_t i = 0; i < 20; ++i) {
+        uint16_t count = 60000 + nextRandom() % 5000;
+        uint8_t tolerance = 1 + nextRandom() % 8;
+        bool expected = burst(count, 512, 0, 1 + i % 3, tolerance);
+        TEST_ASSERT_EQUAL(expected, adc_burstConfident(0, tolerance, 2));
+    }
+}
+
+void test_constant_signal() {
+    burst(64, 700, 0, 0, 0);
+    TEST_ASSERT_TRUE(adc_burstConfident(0, 0, 2));
+    // Первая выборка отличается от остальных - это уже разброс
+    TEST_ASSERT_FALSE(burst(64, 700, 3, 0, 0));
+    TEST_ASSERT_FALSE(adc_burstConfident(0, 0, 2));
+    TEST_ASSERT_TRUE(burst(64, 700, 3, 0, 8));
+    TEST_ASSERT_TRUE(adc_burstConfident(0, 8, 2));
+}
+
+void test_min_count() {
+    burst(32, 300, 0, 0, 16);
+    TEST_ASSERT_TRUE(adc_burstConfident(0, 16, 32));
+    TEST_ASSERT_FALSE(adc_burstConfident(0, 16, 33));
+}
+
+// Кольцо на ADC_BUFFER_SIZE ячеек, одна всегда свободна
+static const uint8_t BUFFER_CAPACITY = ADC_BUFFER_SIZE - 1;
+
+// Пустой буфер без пакета: выборки идут в кольцо
+static void emptyBuffer() {
+    adc_stop();
+    adc_flush();
+}
+
+void test_buffer_wraparound() {
+    emptyBuffer();
+    uint16_t pushed = 0, expected = 0;
+    // 20 раундов по 20 выборок - голова и хвост много раз проходят конец
+    for (uint8_t round = 0; round < 20; ++round) {
+        for (uint8_t i = 0; i < 20; ++i)
+            adc_stubPush(pushed++);
+        TEST_ASSERT_EQUAL(20, adc_available());
+        for (uint8_t i = 0; i < 20; ++i)
+            TEST_ASSERT_EQUAL(expected++, adc_read());
+        TEST_ASSERT_EQUAL(0, adc_available());
+    }
+    TEST_ASSERT_EQUAL(0, adc_read());
+}
+
+void test_buffer_interleaved() {
+    emptyBuffer();
+    uint16_t lost = adc_overruns();
+    uint16_t pushed = 0, expected = 0;
+    // Производитель на выборку впереди потребителя, пока кольцо не заполнится
+    for (uint8_t i = 0; i < BUFFER_CAPACITY - 1; ++i) {
+        adc_stubPush(pushed++);
+        adc_stubPush(pushed++);
+        TEST_ASSERT_EQUAL(expected++, adc_read());
+        TEST_ASSERT_EQUAL(i + 1, adc_available());
+    }
+    TEST_ASSERT_EQUAL(BUFFER_CAPACITY - 1, adc_available());
+    TEST_ASSERT_EQUAL(lost, adc_overruns());
+    // Ещё две выборки: одна занимает последнюю ячейку, вторая теряется
+    adc_stubPush(pushed++);
+    adc_stubPush(pushed);
+    TEST_ASSERT_EQUAL(BUFFER_CAPACITY, adc_available());
+    TEST_ASSERT_EQUAL(lost + 1, adc_overruns());
+    while (adc_available())
+        TEST_ASSERT_EQUAL(expected++, adc_read());
+    TEST_ASSERT_EQUAL(pushed, expected);
+}
+
+void test_buffer_overflow() {
+    emptyBuffer();
+    // Начать не с нулевой ячейки, чтобы переполнение пришлось на переход
+    for (uint8_t i = 0; i < 20; ++i)
+        adc_stubPush(0);
+    adc_flush();
+    uint16_t lost = adc_overruns();
+    for (uint16_t i = 0; i < 40; ++i)
+        adc_stubPush(100 + i);
+    // Лишние выборки отбрасываются, уже лежащие в буфере не портятся
+    TEST_ASSERT_EQUAL(BUFFER_CAPACITY, adc_available());
+    TEST_ASSERT_EQUAL(lost + 40 - BUFFER_CAPACITY, adc_overruns());
+    for (uint8_t i = 0; i < BUFFER_CAPACITY; ++i)
+        TEST_ASSERT_EQUAL(100 + i, adc_read());
+    TEST_ASSERT_EQUAL(0, adc_available());
+    // После освобождения буфер снова принимает выборки
+    adc_stubPush(7);
+    TEST_ASSERT_EQUAL(1, adc_available());
+    TEST_ASSERT_EQUAL(7, adc_read());
+    TEST_ASSERT_EQUAL(lost + 40 - BUFFER_CAPACITY, adc_overruns());
+}
+
+void test_buffer_block_drain() {
+    emptyBuffer();
+    for (uint8_t i = 0; i < 25; ++i)
+        adc_stubPush(0);
+    adc_flush();
+    uint32_t expected_sum = 0;
+    for (uint16_t i = 0; i < BUFFER_CAPACITY; ++i) {
+        adc_stubPush(1000 - i);
+        if (i < 10)
+            expected_sum += 1000 - i;
+    }
+    // Блок ограничен max_count, сумма добавляется к переданной
+    uint32_t sum = 5;
+    TEST_ASSERT_EQUAL(10, adc_readBlock(sum, 10));
+    TEST_ASSERT_EQUAL_UINT32(5 + expected_sum, sum);
+    TEST_ASSERT_EQUAL(BUFFER_CAPACITY - 10, adc_available());
+    TEST_ASSERT_EQUAL(1000 - 10, adc_read());
+    // Остаток забирается целиком, блок проходит через конец кольца
+    expected_sum = 0;
+    for (uint16_t i = 11; i < BUFFER_CAPACITY; ++i)
+        expected_sum += 1000 - i;
+    sum = 0;
+    TEST_ASSERT_EQUAL(BUFFER_CAPACITY - 11, adc_readBlock(sum, 1000));
+    TEST_ASSERT_EQUAL_UINT32(expected_sum, sum);
+    TEST_ASSERT_EQUAL(0, adc_available());
+    sum = 0;
+    TEST_ASSERT_EQUAL(0, adc_readBlock(sum, 1000));
+    TEST_ASSERT_EQUAL_UINT32(0, sum);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_exact_condition);
+    RUN_TEST(test_long_bursts);
+    RUN_TEST(test_constant_signal);
+    RUN_TEST(test_min_count);
+    RUN_TEST(test_buffer_wraparound);
+    RUN_TEST(test_buffer_interleaved);
+    RUN_TEST(test_buffer_overflow);
+    RUN_TEST(test_buffer_block_drain);
+    return UNITY_END();
+}
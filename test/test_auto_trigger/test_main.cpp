@@ -0,0 +1,110 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "sim.h"
+
+/*
+    Запуск по изменению в автоматическом режиме: пробы одним светодиодом,
+    полное измерение при сдвиге пробы больше порога и отправка в Serial
+    только при сдвиге цвета больше порога дельты E
+*/
+
+// Прошивка целиком (src/main.cpp)
+void setup();
+void loop();
+extern uint16_t auto_probes, auto_readings, auto_reports;
+
+// Проходы loop() в течение ms мс, по 100 мкс (loop() может и поспать)
+static void run(uint32_t ms) {
+    uint64_t until = sim_time() + ms * 1000ULL;
+    while (sim_time() < until) {
+        loop();
+        sim_advance(100);
+    }
+}
+
+static void command(const char *line) {
+    sim_serialInput(line);
+    sim_serialInput("\n");
+    run(100);
+}
+
+static uint16_t probes, readings, reports;
+static uint32_t frames;
+
+static void mark() {
+    probes = auto_probes;
+    readings = auto_readings;
+    reports = auto_reports;
+    frames = sim_serialReadings();
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// Неподвижный образец: только пробы, ни полных измерений, ни пакетов
+void test_static_target_sends_nothing() {
+    sim_setColor(150, 100, 50);
+    setup();
+    command("A 200");
+    // Порог пробы 4 из 255, дельты E - 15, пробы через 50 мс
+    command("U 4 1500 50");
+    // Первое измерение после включения отправляется в любом случае
+    run(1000);
+    TEST_ASSERT_GREATER_THAN(0, sim_serialReadings());
+    mark();
+    run(3000);
+    TEST_ASSERT_GREATER_THAN(probes + 10, auto_probes);
+    TEST_ASSERT_EQUAL_UINT16(readings, auto_readings);
+    TEST_ASSERT_EQUAL_UINT16(reports, auto_reports);
+    TEST_ASSERT_EQUAL_UINT32(frames, sim_serialReadings());
+}
+
+// Сдвиг пробы больше порога сразу запускает полное измерение, а
+// большой сдвиг цвета уходит в Serial
+void test_probe_change_starts_full_reading() {
+    mark();
+    sim_setColor(40, 180, 200);
+    run(400);
+    TEST_ASSERT_GREATER_THAN(readings, auto_readings);
+    TEST_ASSERT_GREATER_THAN(reports, auto_reports);
+    TEST_ASSERT_GREATER_THAN(frames, sim_serialReadings());
+    // И снова только пробы
+    run(500);
+    mark();
+    run(2000);
+    TEST_ASSERT_EQUAL_UINT16(readings, auto_readings);
+    TEST_ASSERT_EQUAL_UINT32(frames, sim_serialReadings());
+}
+
+// Сдвиг заметен пробе, но дельта E меньше порога: измерение есть,
+// пакета нет
+void test_small_delta_e_is_suppressed() {
+    mark();
+    sim_setColor(40 + 12, 180, 200);
+    run(1000);
+    TEST_ASSERT_GREATER_THAN(readings, auto_readings);
+    TEST_ASSERT_EQUAL_UINT16(reports, auto_reports);
+    TEST_ASSERT_EQUAL_UINT32(frames, sim_serialReadings());
+}
+
+// Дельта E больше порога от последнего отправленного цвета: ровно один
+// пакет, дальше снова только пробы
+void test_large_delta_e_is_reported() {
+    mark();
+    sim_setColor(200, 180, 200);
+    run(1000);
+    TEST_ASSERT_GREATER_THAN(readings, auto_readings);
+    TEST_ASSERT_EQUAL_UINT16(reports + 1, auto_reports);
+    TEST_ASSERT_EQUAL_UINT32(frames + 1, sim_serialReadings());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_static_target_sends_nothing);
+    RUN_TEST(test_probe_change_starts_full_reading);
+    RUN_TEST(test_small_delta_e_is_suppressed);
+    RUN_TEST(test_large_delta_e_is_reported);
+    return UNITY_END();
+}
@@ -0,0 +1,89 @@
+#include <Arduino.h>
+#include <string.h>
+#include <unity.h>
+
+#include "LCD_1602_RUS.h"
+#include "sim.h"
+
+/*
+    Итог калибровки в прошивке: и неудача, и успех выводятся одной и той же
+    строкой в Serial и на экран, экран держится CALIBRATION_RESULT_TIME
+    без остановки loop(), нажатие энкодера возвращает в режим раньше
+*/
+
+// Прошивка целиком (src/main.cpp)
+void setup();
+void loop();
+extern LCD_1602_RUS lcd;
+const uint8_t ENCODER_SW = 4;
+const uint32_t RESULT_TIME = 3000;
+
+// Проходы loop() в течение ms мс, по 100 мкс (loop() может и поспать)
+static void run(uint32_t ms) {
+    uint64_t until = sim_time() + ms * 1000ULL;
+    while (sim_time() < until) {
+        loop();
+        sim_advance(100);
+    }
+}
+
+static void command(const char *line) {
+    sim_serialInput(line);
+    sim_serialInput("\n");
+    run(100);
+}
+
+static bool showing(const char *text) {
+    return strstr(lcd.row(1), text) != NULL;
+}
+
+// Белый и чёрный образцы с заданной яркостью, до появления итога на экране
+static void calibrate(uint8_t white, uint8_t black, const char *result) {
+    sim_setColor(white, white, white);
+    command("C");
+    run(15000);
+    sim_setColor(black, black, black);
+    for (uint16_t i = 0; i < 300 && !showing(result); ++i)
+        run(100);
+    TEST_ASSERT_TRUE_MESSAGE(showing(result), lcd.row(1));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_failure_is_shown() {
+    setup();
+    // "Чёрный" образец светлее белого
+    calibrate(128, 255, "failed: W >= B");
+    TEST_ASSERT_EQUAL_UINT32(0, lcd.glyphOverflows);
+    TEST_ASSERT_EQUAL_STRING("Calibration failed: white >= black",
+                             sim_serialLastLine());
+    // Сообщение держится, пока не истечёт время показа
+    run(RESULT_TIME - 500);
+    TEST_ASSERT_TRUE(showing("failed: W >= B"));
+    run(1000);
+    TEST_ASSERT_FALSE(showing("failed: W >= B"));
+    // Прежний режим снова выдаёт измерения
+    uint32_t readings = sim_serialReadings();
+    run(3000);
+    TEST_ASSERT_GREATER_THAN(readings, sim_serialReadings());
+}
+
+void test_success_is_shown() {
+    calibrate(255, 0, "done");
+    TEST_ASSERT_EQUAL_STRING("Calibration done", sim_serialLastLine());
+    // Нажатие возвращает в режим, не дожидаясь конца показа
+    sim_setPin(ENCODER_SW, LOW);
+    run(100);
+    sim_setPin(ENCODER_SW, HIGH);
+    run(200);
+    TEST_ASSERT_FALSE(showing("done"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_failure_is_shown);
+    RUN_TEST(test_success_is_shown);
+    return UNITY_END();
+}
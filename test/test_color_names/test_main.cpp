@@ -0,0 +1,105 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <unity.h>
+
+#include "color_names.hpp"
+
+/*
+    Поиск по k-d дереву палитры против перебора всех цветов палитры для
+    каждого цвета сетки RGB. При равных расстояниях найденный номер может
+    отличаться, поэтому сравниваются расстояния
+*/
+
+static uint32_t distance2(const ColorLab &color, uint16_t index) {
+    ColorLab named;
+    memcpy_P(&named, NAMED_COLORS[index].lab, sizeof(named));
+    return color_distance2(color, named);
+}
+
+static uint16_t linearScan(const ColorLab &color) {
+    uint16_t best = 0;
+    uint32_t best_distance = UINT32_MAX;
+    for (uint16_t i = 0; i < NAMED_COLORS_COUNT; ++i) {
+        uint32_t distance = distance2(color, i);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = i;
+        }
+    }
+    return best;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// Узлы диапазона [lo, hi) лежат по нужную сторону от своего среднего
+static void checkTree(uint16_t lo, uint16_t hi, uint8_t axis) {
+    if (hi - lo < 2)
+        return;
+    uint16_t middle = lo + (hi - lo) / 2;
+    int16_t split = pgm_read_word(&NAMED_COLORS[middle].lab[axis]);
+    for (uint16_t i = lo; i < hi; ++i) {
+        int16_t value = pgm_read_word(&NAMED_COLORS[i].lab[axis]);
+        if (i < middle)
+            TEST_ASSERT_LESS_OR_EQUAL(split, value);
+        else if (i > middle)
+            TEST_ASSERT_GREATER_OR_EQUAL(split, value);
+    }
+    uint8_t next = axis == 2 ? 0 : axis + 1;
+    checkTree(lo, middle, next);
+    checkTree(middle + 1, hi, next);
+}
+
+void test_palette_is_kd_tree() {
+    TEST_ASSERT_GREATER_THAN(1, NAMED_COLORS_COUNT);
+    checkTree(0, NAMED_COLORS_COUNT, 0);
+}
+
+// Каждый цвет палитры находит сам себя
+void test_palette_colors_find_themselves() {
+    for (uint16_t i = 0; i < NAMED_COLORS_COUNT; ++i) {
+        ColorLab color;
+        memcpy_P(&color, NAMED_COLORS[i].lab, sizeof(color));
+        uint16_t distance;
+        uint16_t found = colornames_find(color, distance);
+        TEST_ASSERT_EQUAL_UINT16(0, distance);
+        TEST_ASSERT_EQUAL_UINT32(0, distance2(color, found));
+    }
+}
+
+void test_matches_linear_scan() {
+    uint32_t checked = 0, ties = 0;
+    for (uint16_t r = 0; r <= 255; ++r)
+        for (uint16_t g = 0; g <= 255; ++g)
+            for (uint16_t b = 0; b <= 255; ++b) {
+                ColorLab color;
+                color_toLab(r, g, b, color);
+                uint16_t distance;
+                uint16_t found = colornames_find(color, distance);
+                uint16_t expected = linearScan(color);
+                if (found != expected) {
+                    char message[64];
+                    snprintf(message, sizeof(message),
+                             "#%02X%02X%02X: %u vs %u", r, g, b, found,
+                             expected);
+                    TEST_ASSERT_EQUAL_UINT32_MESSAGE(
+                        distance2(color, expected), distance2(color, found),
+                        message);
+                    ties++;
+                }
+                checked++;
+            }
+    char message[64];
+    snprintf(message, sizeof(message), "%lu colours, %lu equal-distance ties",
+             (unsigned long)checked, (unsigned long)ties);
+    TEST_MESSAGE(message);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_palette_is_kd_tree);
+    RUN_TEST(test_palette_colors_find_themselves);
+    RUN_TEST(test_matches_linear_scan);
+    return UNITY_END();
+}
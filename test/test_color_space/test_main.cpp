@@ -0,0 +1,266 @@
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include <unity.h>
+
+#include "color_space.hpp"
+
+/*
+    Целочисленные HSV, XYZ и L*a*b* против расчёта в double по всей сетке
+    RGB, все 2^24 цветов. Допуски - из описания в color_space.hpp, в
+    единицах вывода
+*/
+
+struct Reference {
+    double hsv[3];
+    double xyz[3];  // x10000
+    double lab[3];  // x100
+};
+
+static double linear[256];
+
+static void buildLinear() {
+    for (uint16_t value = 0; value <= 255; ++value) {
+        double c = value / 255.0;
+        linear[value] =
+            c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+    }
+}
+
+static double labF(double t) {
+    const double delta = 6.0 / 29;
+    return t > delta * delta * delta ? cbrt(t)
+                                     : t / (3 * delta * delta) + 4.0 / 29;
+}
+
+static void reference(uint8_t r, uint8_t g, uint8_t b, Reference &out) {
+    double high = max(r, max(g, b)), low = min(r, min(g, b));
+    double delta = high - low, hue = 0;
+    if (delta) {
+        if (high == r)
+            hue = 60 * fmod((g - b) / delta + 6, 6);
+        else if (high == g)
+            hue = 60 * ((b - r) / delta + 2);
+        else
+            hue = 60 * ((r - g) / delta + 4);
+    }
+    out.hsv[0] = hue;
+    out.hsv[1] = high ? 255 * delta / high : 0;
+    out.hsv[2] = high;
+
+    double lr = linear[r], lg = linear[g], lb = linear[b];
+    const double matrix[3][3] = {{0.4124564, 0.3575761, 0.1804375},
+                                 {0.2126729, 0.7151522, 0.0721750},
+                                 {0.0193339, 0.1191920, 0.9503041}};
+    const double white[3] = {0.95047, 1.0, 1.08883};
+    double f[3];
+    for (uint8_t i = 0; i < 3; ++i) {
+        double value =
+            matrix[i][0] * lr + matrix[i][1] * lg + matrix[i][2] * lb;
+        out.xyz[i] = value * 10000;
+        f[i] = labF(value / white[i]);
+    }
+    out.lab[0] = (116 * f[1] - 16) * 100;
+    out.lab[1] = 500 * (f[0] - f[1]) * 100;
+    out.lab[2] = 200 * (f[1] - f[2]) * 100;
+}
+
+// Разность оттенков по кругу
+static double hueError(double expected, double actual) {
+    double error = fabs(expected - actual);
+    return min(error, 360 - error);
+}
+
+typedef void (*Visit)(uint8_t r, uint8_t g, uint8_t b);
+
+static void forEachColor(Visit visit) {
+    for (uint16_t r = 0; r <= 255; ++r)
+        for (uint16_t g = 0; g <= 255; ++g)
+            for (uint16_t b = 0; b <= 255; ++b)
+                visit(r, g, b);
+}
+
+static double worst[3];
+
+static void report(const char *space) {
+    char message[96];
+    snprintf(message, sizeof(message), "%s max error: %.3f, %.3f, %.3f",
+             space, worst[0], worst[1], worst[2]);
+    TEST_MESSAGE(message);
+}
+
+void setUp() { worst[0] = worst[1] = worst[2] = 0; }
+
+void tearDown() {}
+
+static void visitHsv(uint8_t r, uint8_t g, uint8_t b) {
+    Reference expected;
+    reference(r, g, b, expected);
+    int16_t hsv[3];
+    color_toHsv(r, g, b, hsv);
+    TEST_ASSERT_TRUE(hsv[0] >= 0 && hsv[0] < 360);
+    double errors[3] = {hueError(expected.hsv[0], hsv[0]),
+                        fabs(expected.hsv[1] - hsv[1]),
+                        fabs(expected.hsv[2] - hsv[2])};
+    for (uint8_t i = 0; i < 3; ++i)
+        worst[i] = max(worst[i], errors[i]);
+}
+
+void test_hsv() {
+    forEachColor(visitHsv);
+    report("HSV");
+    // Округление до целого: ровно половина единицы
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(0.5 + 1e-9, worst[0]);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(0.5 + 1e-9, worst[1]);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(0, worst[2]);
+}
+
+static void visitXyz(uint8_t r, uint8_t g, uint8_t b) {
+    Reference expected;
+    reference(r, g, b, expected);
+    int16_t xyz[3];
+    color_toXyz(r, g, b, xyz);
+    for (uint8_t i = 0; i < 3; ++i)
+        worst[i] = max(worst[i], fabs(expected.xyz[i] - xyz[i]));
+}
+
+void test_xyz() {
+    forEachColor(visitXyz);
+    report("XYZ x10000");
+    for (uint8_t i = 0; i < 3; ++i)
+        TEST_ASSERT_LESS_OR_EQUAL_FLOAT(1.2, worst[i]);
+}
+
+static void visitLab(uint8_t r, uint8_t g, uint8_t b) {
+    Reference expected;
+    reference(r, g, b, expected);
+    ColorLab lab;
+    color_toLab(r, g, b, lab);
+    int16_t actual[3] = {lab.l, lab.a, lab.b};
+    for (uint8_t i = 0; i < 3; ++i)
+        worst[i] = max(worst[i], fabs(expected.lab[i] - actual[i]));
+}
+
+void test_lab() {
+    forEachColor(visitLab);
+    report("L*a*b* x100");
+    // Больше всего ошибается a*: разность fx - fy умножается на 500
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(3, worst[0]);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(8.5, worst[1]);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(4.5, worst[2]);
+}
+
+void test_lab_white_and_black() {
+    ColorLab lab;
+    color_toLab(255, 255, 255, lab);
+    TEST_ASSERT_INT_WITHIN(1, 10000, lab.l);
+    TEST_ASSERT_INT_WITHIN(1, 0, lab.a);
+    TEST_ASSERT_INT_WITHIN(1, 0, lab.b);
+    color_toLab(0, 0, 0, lab);
+    TEST_ASSERT_EQUAL_INT16(0, lab.l);
+    TEST_ASSERT_EQUAL_INT16(0, lab.a);
+    TEST_ASSERT_EQUAL_INT16(0, lab.b);
+}
+
+// Дельта E между известными цветами: точное значение по точному L*a*b*
+void test_delta_e() {
+    const uint8_t pairs[][6] = {{255, 255, 255, 0, 0, 0},
+                                {255, 0, 0, 0, 255, 0},
+                                {200, 30, 30, 190, 40, 35},
+                                {128, 128, 128, 129, 128, 128},
+                                {10, 20, 30, 10, 20, 30}};
+    for (uint8_t p = 0; p < 5; ++p) {
+        const uint8_t *c = pairs[p];
+        Reference first, second;
+        reference(c[0], c[1], c[2], first);
+        reference(c[3], c[4], c[5], second);
+        double expected = 0;
+        for (uint8_t i = 0; i < 3; ++i)
+            expected += pow(first.lab[i] - second.lab[i], 2);
+        expected = sqrt(expected);
+        ColorLab a, b;
+        color_toLab(c[0], c[1], c[2], a);
+        color_toLab(c[3], c[4], c[5], b);
+        // Ошибки компонент обоих цветов (3, 8.5 и 4.5 ед.) плюс округление
+        // корня вниз
+        uint32_t distance2 = color_distance2(a, b);
+        uint32_t delta_e = color_deltaE(a, b);
+        TEST_ASSERT_FLOAT_WITHIN(20, expected, delta_e);
+        TEST_ASSERT_LESS_OR_EQUAL(distance2, delta_e * delta_e);
+        TEST_ASSERT_GREATER_THAN(distance2, (delta_e + 1) * (delta_e + 1));
+    }
+    ColorLab black, white;
+    color_toLab(0, 0, 0, black);
+    color_toLab(255, 255, 255, white);
+    TEST_ASSERT_INT_WITHIN(1, 10000, color_deltaE(black, white));
+    TEST_ASSERT_EQUAL_UINT16(0, color_deltaE(white, white));
+}
+
+// Цена на ПК: целочисленные преобразования против расчёта в double (все
+// три пространства сразу) на каждом 4-м значении каждой компоненты.
+// Точность - в тестах выше, такты AVR на ПК не измерить
+void test_benchmark() {
+    const uint8_t STEP = 4;
+    volatile int32_t sink = 0;
+    double ns[5];
+    uint32_t calls = 0;
+    for (uint8_t pass = 0; pass < 5; ++pass) {
+        ColorLab previous = {0, 0, 0};
+        calls = 0;
+        clock_t started = clock();
+        for (uint16_t r = 0; r <= 255; r += STEP)
+            for (uint16_t g = 0; g <= 255; g += STEP)
+                for (uint16_t b = 0; b <= 255; b += STEP) {
+                    int16_t values[3];
+                    ColorLab lab;
+                    Reference expected;
+                    switch (pass) {
+                    case 0:
+                        color_toHsv(r, g, b, values);
+                        sink += values[0];
+                        break;
+                    case 1:
+                        color_toXyz(r, g, b, values);
+                        sink += values[1];
+                        break;
+                    case 2:
+                        color_toLab(r, g, b, lab);
+                        sink += lab.l;
+                        break;
+                    case 3:
+                        // Соседние цвета сетки, как два измерения подряд
+                        lab.l = r * 39;
+                        lab.a = g * 40 - 5000;
+                        lab.b = b * 40 - 5000;
+                        sink += color_deltaE(lab, previous);
+                        previous = lab;
+                        break;
+                    default:
+                        reference(r, g, b, expected);
+                        sink += (int32_t)expected.lab[0];
+                    }
+                    calls++;
+                }
+        ns[pass] = (clock() - started) * 1e9 / CLOCKS_PER_SEC / calls;
+    }
+    char message[128];
+    snprintf(message, sizeof(message),
+             "per color: HSV %.1f ns, XYZ %.1f ns, Lab %.1f ns, dE %.1f ns, "
+             "double reference %.1f ns (host)",
+             ns[0], ns[1], ns[2], ns[3], ns[4]);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_NOT_EQUAL(0, sink);
+}
+
+int main() {
+    buildLinear();
+    UNITY_BEGIN();
+    RUN_TEST(test_hsv);
+    RUN_TEST(test_xyz);
+    RUN_TEST(test_lab);
+    RUN_TEST(test_lab_white_and_black);
+    RUN_TEST(test_delta_e);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
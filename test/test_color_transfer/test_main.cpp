@@ -0,0 +1,160 @@
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include <unity.h>
+
+#include "color_transfer.hpp"
+
+/*
+    Таблица передаточной функции против точных формул: constrain + map
+    для линейной шкалы и модели фоторезистора в double для gamma. Результат
+    целый, поэтому "в пределах 1 ед." - не дальше 1 от округлённого точного
+    значения. В конце - цена map() и таблицы на ПК
+*/
+
+const double GAMMA = 0.7;
+
+static double referenceLight(double level) {
+    level = constrain(level, 0.5, 1022.5);
+    return pow(level / (1023 - level), -1 / GAMMA);
+}
+
+// Яркость 0-255 по точной модели, уровень за пределами шкалы прижат
+static double reference(uint16_t level, uint16_t white, uint16_t black,
+                        bool linearised) {
+    double clamped = constrain(level, white, black);
+    if (!linearised)
+        return 255.0 * (black - clamped) / (black - white);
+    double light_white = referenceLight(white);
+    double light_black = referenceLight(black);
+    return 255 * (referenceLight(clamped) - light_black) /
+           (light_white - light_black);
+}
+
+// Наибольшее отклонение от округлённой точной яркости по всем уровням
+static uint16_t worstError(uint16_t white, uint16_t black, bool linearised) {
+    ColorTransfer transfer;
+    transfer.build(white, black, linearised ? GAMMA : 0);
+    uint16_t worst = 0;
+    for (uint16_t level = 0; level <= 1023; ++level) {
+        long expected = lround(reference(level, white, black, linearised));
+        uint16_t error = labs(transfer.apply(level) - expected);
+        if (error > worst)
+            worst = error;
+    }
+    return worst;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_linear_matches_map() {
+    for (uint16_t white = 0; white < 1023; white += 3)
+        for (uint16_t black = white + 1; black <= 1023; black += 7) {
+            ColorTransfer transfer;
+            transfer.build(white, black, 0);
+            for (uint16_t level = 0; level <= 1023; ++level) {
+                long expected =
+                    map(constrain(level, white, black), white, black, 255, 0);
+                char message[64];
+                snprintf(message, sizeof(message), "%u..%u level %u", white,
+                         black, level);
+                TEST_ASSERT_INT_WITHIN_MESSAGE(1, expected,
+                                               transfer.apply(level), message);
+            }
+            TEST_ASSERT_LESS_OR_EQUAL(1, worstError(white, black, false));
+        }
+}
+
+// Белый образец при полной яркости - от 100 ед. АЦП: ближе к нулю кривая
+// фоторезистора круче, чем проходит таблица из 33 узлов
+void test_gamma_within_one_lsb() {
+    for (uint16_t white = 100; white <= 500; white += 4)
+        for (uint16_t black = white + 100; black <= 1023; black += 9) {
+            char message[32];
+            snprintf(message, sizeof(message), "%u..%u", white, black);
+            TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(
+                1, worstError(white, black, true), message);
+        }
+}
+
+// Одинаковые и перепутанные уровни образцов: шкала в одну единицу у
+// белого, светлее - 255, темнее - 0
+void test_degenerate_ranges() {
+    const uint16_t ranges[][2] = {{300, 300}, {600, 300}, {0, 0},
+                                  {1023, 1023}, {1023, 0}};
+    for (uint8_t r = 0; r < 5; ++r)
+        for (uint8_t linearised = 0; linearised < 2; ++linearised) {
+            ColorTransfer transfer;
+            uint16_t white = ranges[r][0];
+            transfer.build(white, ranges[r][1], linearised ? GAMMA : 0);
+            TEST_ASSERT_EQUAL_UINT16(white + 1, transfer.black());
+            for (uint32_t level = 0; level <= 1100; ++level)
+                TEST_ASSERT_EQUAL_UINT8(level <= white ? 255 : 0,
+                                        transfer.apply(level));
+        }
+}
+
+// Уровни на краю шкалы и за ним (передискретизация, мусор в EEPROM)
+void test_levels_beyond_scale() {
+    const uint16_t levels[] = {1022, 1023, 1024, 2047, 4095, 65535};
+    for (uint8_t linearised = 0; linearised < 2; ++linearised) {
+        ColorTransfer full, narrow;
+        full.build(0, 1023, linearised ? GAMMA : 0);
+        narrow.build(200, 800, linearised ? GAMMA : 0);
+        for (uint8_t i = 0; i < 6; ++i) {
+            TEST_ASSERT_EQUAL_UINT8(0, narrow.apply(levels[i]));
+            TEST_ASSERT_EQUAL_UINT8(0, narrow.apply(levels[i], 64));
+            if (levels[i] >= 1023)
+                TEST_ASSERT_EQUAL_UINT8(0, full.apply(levels[i]));
+        }
+        TEST_ASSERT_EQUAL_UINT8(255, full.apply(0));
+        TEST_ASSERT_LESS_OR_EQUAL(1, full.apply(1022));
+    }
+}
+
+// Цена на ПК: constrain + map (деление) против таблицы (умножение)
+void test_map_benchmark() {
+    const uint8_t SPANS = 64;
+    ColorTransfer transfers[SPANS];
+    uint16_t whites[SPANS], blacks[SPANS];
+    for (uint8_t i = 0; i < SPANS; ++i) {
+        whites[i] = 100 + i * 3;
+        blacks[i] = 700 + i * 4;
+        transfers[i].build(whites[i], blacks[i], GAMMA);
+    }
+    const uint8_t ROUNDS = 20;
+    volatile uint32_t sink = 0;
+    clock_t started = clock();
+    for (uint8_t round = 0; round < ROUNDS; ++round)
+        for (uint8_t i = 0; i < SPANS; ++i)
+            for (uint16_t level = 0; level <= 1023; ++level)
+                sink += map(constrain(level, whites[i], blacks[i]), whites[i],
+                            blacks[i], 255, 0);
+    double map_ns = (clock() - started) * 1e9 / CLOCKS_PER_SEC;
+    started = clock();
+    for (uint8_t round = 0; round < ROUNDS; ++round)
+        for (uint8_t i = 0; i < SPANS; ++i)
+            for (uint16_t level = 0; level <= 1023; ++level)
+                sink += transfers[i].apply(level);
+    double table_ns = (clock() - started) * 1e9 / CLOCKS_PER_SEC;
+    double calls = (double)ROUNDS * SPANS * 1024;
+    char message[96];
+    snprintf(message, sizeof(message),
+             "per value: map %.2f ns, table %.2f ns (host)", map_ns / calls,
+             table_ns / calls);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_GREATER_THAN(0, sink);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_linear_matches_map);
+    RUN_TEST(test_gamma_within_one_lsb);
+    RUN_TEST(test_degenerate_ranges);
+    RUN_TEST(test_levels_beyond_scale);
+    RUN_TEST(test_map_benchmark);
+    return UNITY_END();
+}
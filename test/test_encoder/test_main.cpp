@@ -0,0 +1,183 @@
+#include <Arduino.h>
+#include <GyverEncoder.h>
+#include <unity.h>
+
+#include "sim.h"
+
+/*
+    Декодирование энкодера в прерываниях: последовательности CLK/DT с
+    дребезгом через sim_setPin() (каждое изменение вызывает обработчик,
+    как INT0/INT1), подсчёт поворотов, кнопка и переполнение очереди
+*/
+
+const uint8_t CLK_PIN = 2;
+const uint8_t DT_PIN = 3;
+const uint8_t SW_PIN = 4;
+
+// Положение - CLK | DT << 1. Направо: 11 -> 10 -> 00 -> 01 -> 11
+const uint8_t RIGHT[] = {0b10, 0b00, 0b01, 0b11};
+const uint8_t LEFT[] = {0b01, 0b00, 0b10, 0b11};
+
+struct Events {
+    uint8_t right, left, right_pressed, left_pressed;
+};
+
+static Encoder *encoder;
+static uint8_t position = 0b11;
+
+// Перейти в соседнее положение, по пути ворота дребезжат bounces раз
+static void moveTo(uint8_t next, uint8_t bounces = 0) {
+    uint8_t changed = position ^ next;
+    uint8_t pin = changed & 1 ? CLK_PIN : DT_PIN;
+    uint8_t level = changed & 1 ? next & 1 : next >> 1;
+    for (uint8_t i = 0; i < bounces; ++i) {
+        sim_setPin(pin, level);
+        sim_setPin(pin, !level);
+    }
+    sim_setPin(pin, level);
+    position = next;
+}
+
+static void turn(const uint8_t (&steps)[4], uint8_t bounces = 0) {
+    for (uint8_t i = 0; i < 4; ++i)
+        moveTo(steps[i], bounces);
+}
+
+// Забрать все повороты из очереди
+static Events drain() {
+    Events events = {};
+    for (uint8_t i = 0; i < 64; ++i) {
+        encoder->tick();
+        if (encoder->isRight())
+            events.right++;
+        else if (encoder->isLeft())
+            events.left++;
+        else if (encoder->isRightH())
+            events.right_pressed++;
+        else if (encoder->isLeftH())
+            events.left_pressed++;
+        else if (!encoder->isTurnQueued())
+            break;
+    }
+    return events;
+}
+
+static void setUpEncoder(boolean type) {
+    delete encoder;
+    position = 0b11;
+    sim_setPin(CLK_PIN, HIGH);
+    sim_setPin(DT_PIN, HIGH);
+    sim_setPin(SW_PIN, HIGH);
+    encoder = new Encoder(CLK_PIN, DT_PIN, SW_PIN, type);
+    TEST_ASSERT_TRUE(encoder->attachInterrupts());
+}
+
+void setUp() { setUpEncoder(TYPE2); }
+
+void tearDown() {}
+
+void test_clean_turns() {
+    turn(RIGHT);
+    turn(RIGHT);
+    turn(LEFT);
+    Events events = drain();
+    TEST_ASSERT_EQUAL_UINT8(2, events.right);
+    TEST_ASSERT_EQUAL_UINT8(1, events.left);
+    TEST_ASSERT_EQUAL_UINT8(0, encoder->lostTurns());
+}
+
+// Дребезг на каждом переходе даёт шаги туда и обратно
+void test_bouncing_turns() {
+    for (uint8_t bounces = 1; bounces <= 5; ++bounces) {
+        turn(RIGHT, bounces);
+        turn(LEFT, bounces);
+        turn(RIGHT, bounces);
+        Events events = drain();
+        TEST_ASSERT_EQUAL_UINT8(2, events.right);
+        TEST_ASSERT_EQUAL_UINT8(1, events.left);
+    }
+    TEST_ASSERT_EQUAL_UINT8(0, encoder->lostTurns());
+}
+
+// Дребезг у фиксированного положения и полшага с возвратом - не поворот
+void test_bounce_at_detent_is_ignored() {
+    for (uint8_t i = 0; i < 10; ++i) {
+        moveTo(0b10);
+        moveTo(0b11);
+    }
+    moveTo(0b10, 3);
+    moveTo(0b00, 3);
+    moveTo(0b10, 3);
+    moveTo(0b11, 3);
+    Events events = drain();
+    TEST_ASSERT_EQUAL_UINT8(0, events.right + events.left);
+}
+
+// Прерывание пропустило промежуточное положение: скачок через шаг таблица
+// не считает, но оставшихся шагов хватает на один поворот
+void test_skipped_state() {
+    moveTo(0b10);
+    // CLK и DT меняются до того, как обработчик успел прочитать входы
+    digitalWrite(CLK_PIN, HIGH);
+    digitalWrite(DT_PIN, LOW);
+    encoder->isr();
+    position = 0b01;
+    moveTo(0b11);
+    Events events = drain();
+    TEST_ASSERT_EQUAL_UINT8(1, events.right);
+    TEST_ASSERT_EQUAL_UINT8(0, events.left);
+    turn(LEFT);
+    TEST_ASSERT_EQUAL_UINT8(1, drain().left);
+}
+
+// Полушаговый энкодер: фиксированные положения 11 и 00
+void test_half_step_type() {
+    setUpEncoder(TYPE1);
+    turn(RIGHT, 2);
+    turn(LEFT);
+    Events events = drain();
+    TEST_ASSERT_EQUAL_UINT8(2, events.right);
+    TEST_ASSERT_EQUAL_UINT8(2, events.left);
+}
+
+void test_pressed_turns() {
+    sim_setPin(SW_PIN, LOW);
+    turn(RIGHT, 1);
+    turn(LEFT, 1);
+    sim_setPin(SW_PIN, HIGH);
+    turn(LEFT);
+    Events events = drain();
+    TEST_ASSERT_EQUAL_UINT8(1, events.right_pressed);
+    TEST_ASSERT_EQUAL_UINT8(1, events.left_pressed);
+    TEST_ASSERT_EQUAL_UINT8(1, events.left);
+    TEST_ASSERT_EQUAL_UINT8(0, events.right);
+}
+
+// В очереди ENC_QUEUE_SIZE - 1 поворот, остальные считаются потерянными
+void test_queue_overflow() {
+    const uint8_t TURNS = 12;
+    for (uint8_t i = 0; i < TURNS; ++i)
+        turn(RIGHT, 1);
+    TEST_ASSERT_TRUE(encoder->isTurnQueued());
+    TEST_ASSERT_EQUAL_UINT8(TURNS - (ENC_QUEUE_SIZE - 1),
+                            encoder->lostTurns());
+    Events events = drain();
+    TEST_ASSERT_EQUAL_UINT8(ENC_QUEUE_SIZE - 1, events.right);
+    // После освобождения очереди повороты снова проходят
+    turn(LEFT);
+    TEST_ASSERT_EQUAL_UINT8(1, drain().left);
+    TEST_ASSERT_EQUAL_UINT8(TURNS - (ENC_QUEUE_SIZE - 1),
+                            encoder->lostTurns());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_clean_turns);
+    RUN_TEST(test_bouncing_turns);
+    RUN_TEST(test_bounce_at_detent_is_ignored);
+    RUN_TEST(test_skipped_state);
+    RUN_TEST(test_half_step_type);
+    RUN_TEST(test_pressed_turns);
+    RUN_TEST(test_queue_overflow);
+    return UNITY_END();
+}
@@ -0,0 +1,104 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "head_scheduler.hpp"
+#include "sim.h"
+
+/*
+    Отмена измерения развязанных датчиков посреди пакета выборок и новое
+    измерение после неё: пакет не должен переживать cancel(), новое
+    измерение снова ждёт установления и набирает полный пакет
+*/
+
+const uint16_t SAMPLES = 256;
+
+constexpr AcquisitionPhase PHASES[][3] PROGMEM = {
+    {{6, 200, SAMPLES, 0}, {7, 200, SAMPLES, 1}, {8, 200, SAMPLES, 2}},
+    {{9, 200, SAMPLES, 0}, {10, 200, SAMPLES, 1}, {11, 200, SAMPLES, 2}}};
+const uint8_t PINS[] = {A0, A1};
+
+static SettleDetector settle(20, 200, 1, 3);
+static HeadScheduler<3, 2> heads(PHASES, PINS, settle);
+
+// Проходы tick() до конца измерения (0 - не закончилось)
+static uint32_t finish() {
+    for (uint32_t passes = 1; passes < 100000; ++passes) {
+        if (heads.tick())
+            return passes;
+        sim_advance(100);
+    }
+    return 0;
+}
+
+// Дойти до набора пакета выборок и набрать его часть
+static void startBurst() {
+    heads.start();
+    for (uint32_t passes = 0; heads.isWaiting() && passes < 100000; ++passes) {
+        heads.tick();
+        sim_advance(100);
+    }
+    TEST_ASSERT_FALSE(heads.isWaiting());
+    for (uint8_t i = 0; i < 50; ++i) {
+        heads.tick();
+        sim_advance(100);
+    }
+}
+
+void setUp() {
+    sim_setHeadColor(0, 200, 30, 30);
+    sim_setHeadColor(1, 30, 30, 200);
+}
+
+void tearDown() {}
+
+void test_cancel_mid_burst_then_restart() {
+    heads.start();
+    TEST_ASSERT_NOT_EQUAL(0, finish());
+    uint16_t reference[2][3];
+    for (uint8_t h = 0; h < 2; ++h)
+        for (uint8_t i = 0; i < 3; ++i)
+            reference[h][i] = heads.level(i, h);
+
+    startBurst();
+    heads.cancel();
+    TEST_ASSERT_FALSE(heads.isRunning());
+    // Светодиоды погашены и после отмены не зажигаются
+    double lit = sim_ledOnSeconds();
+    sim_advance(100000);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, lit, sim_ledOnSeconds());
+
+    heads.start();
+    TEST_ASSERT_NOT_EQUAL(0, finish());
+    for (uint8_t h = 0; h < 2; ++h)
+        for (uint8_t i = 0; i < 3; ++i) {
+            TEST_ASSERT_EQUAL_UINT16(SAMPLES, heads.samplesUsed(i, h));
+            TEST_ASSERT_GREATER_OR_EQUAL(20, heads.settleTime(i, h));
+            TEST_ASSERT_UINT_WITHIN(3, reference[h][i], heads.level(i, h));
+        }
+}
+
+void test_repeated_cancels() {
+    for (uint8_t i = 0; i < 5; ++i) {
+        startBurst();
+        heads.cancel();
+        sim_advance(1000);
+    }
+    heads.start();
+    TEST_ASSERT_NOT_EQUAL(0, finish());
+    TEST_ASSERT_LESS_THAN(heads.level(1, 0) - 100, heads.level(0, 0));
+    TEST_ASSERT_LESS_THAN(heads.level(1, 1) - 100, heads.level(2, 1));
+}
+
+int main() {
+    sim_setLed(0, 6, 800, 0);
+    sim_setLed(1, 7, 800, 0);
+    sim_setLed(2, 8, 800, 0);
+    sim_setLed(4, 9, 800, 1);
+    sim_setLed(5, 10, 800, 1);
+    sim_setLed(6, 11, 800, 1);
+    heads.begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_cancel_mid_burst_then_restart);
+    RUN_TEST(test_repeated_cancels);
+    return UNITY_END();
+}
@@ -0,0 +1,164 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "idle_sleep.hpp"
+#include "lcd_framebuffer.hpp"
+#include "serial_batch.hpp"
+#include "sim.h"
+
+/*
+    Сон на виртуальных часах: idle_sleep() до срока и досрочно по wake(),
+    учёт времени сна, и решение прошивки canSleep(): нельзя спать, пока
+    идёт измерение, не показан экран или не отправлен пакет
+*/
+
+// Прошивка целиком (src/main.cpp)
+void setup();
+void loop();
+bool canSleep();
+extern LcdFramebuffer screen;
+extern SerialBatch serial_batch;
+extern uint32_t last_input_at;
+const uint8_t ENCODER_SW = 4;
+
+static bool never() { return false; }
+
+static uint8_t wake_after = 0;
+
+// Просыпаемся на wake_after-й проверке
+static bool wakeCountdown() { return wake_after && !--wake_after; }
+
+// Проходы loop() в течение ms мс, по 100 мкс (loop() может и поспать)
+static void run(uint32_t ms) {
+    uint64_t until = sim_time() + ms * 1000ULL;
+    while (sim_time() < until) {
+        loop();
+        sim_advance(100);
+    }
+}
+
+// Команда по Serial. Время последнего ввода сдвигается назад, чтобы
+// canSleep() решала по состоянию прошивки, а не по паузе после ввода
+static void command(const char *line) {
+    sim_serialInput(line);
+    sim_serialInput("\n");
+    loop();
+    last_input_at = millis() - 60000UL;
+}
+
+// Нажатие кнопки энкодера и время на измерение
+static void click() {
+    sim_setPin(ENCODER_SW, LOW);
+    run(100);
+    sim_setPin(ENCODER_SW, HIGH);
+    run(1000);
+}
+
+void setUp() {
+    // Сон начинается на границе миллисекунды
+    sim_advance(1000 - micros() % 1000);
+    idle_reset();
+}
+
+void tearDown() {}
+
+void test_sleep_until_deadline() {
+    uint32_t started = millis();
+    TEST_ASSERT_FALSE(idle_sleep(25, never));
+    TEST_ASSERT_EQUAL_UINT32(started + 25, millis());
+    TEST_ASSERT_EQUAL_UINT32(1, idle_sleeps());
+    TEST_ASSERT_EQUAL_UINT32(0, idle_earlyWakeups());
+    TEST_ASSERT_EQUAL_UINT32(25, idle_sleptMs());
+}
+
+void test_wake_ends_sleep_early() {
+    uint32_t started = millis();
+    wake_after = 4;
+    TEST_ASSERT_TRUE(idle_sleep(100, wakeCountdown));
+    // Три пробуждения по Timer0 до четвёртой проверки
+    TEST_ASSERT_EQUAL_UINT32(started + 3, millis());
+    TEST_ASSERT_EQUAL_UINT32(1, idle_earlyWakeups());
+    // wake() уже взведён: сон не начинается
+    wake_after = 1;
+    TEST_ASSERT_TRUE(idle_sleep(100, wakeCountdown));
+    TEST_ASSERT_EQUAL_UINT32(started + 3, millis());
+    TEST_ASSERT_EQUAL_UINT32(2, idle_earlyWakeups());
+    TEST_ASSERT_EQUAL_UINT32(2, idle_sleeps());
+}
+
+// 3 сна по 20 мс и 40 мс работы: 60 из 100 мс во сне
+void test_accounting_across_sleeps() {
+    const uint32_t WORK_US[] = {13000, 13000, 14000};
+    TEST_ASSERT_EQUAL_UINT16(10000, idle_awakeX100());
+    for (uint8_t i = 0; i < 3; ++i) {
+        idle_sleep(20, never);
+        sim_advance(WORK_US[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(100, idle_elapsedMs());
+    TEST_ASSERT_EQUAL_UINT32(3, idle_sleeps());
+    TEST_ASSERT_EQUAL_UINT32(60, idle_sleptMs());
+    TEST_ASSERT_EQUAL_UINT16(4000, idle_awakeX100());
+    idle_reset();
+    TEST_ASSERT_EQUAL_UINT32(0, idle_sleptMs());
+    TEST_ASSERT_EQUAL_UINT16(10000, idle_awakeX100());
+}
+
+// Срок считается по смене millis(), как по тикам Timer0: сон с середины
+// миллисекунды короче. Доли миллисекунды копятся между снами
+void test_partial_milliseconds_accumulate() {
+    sim_advance(500);
+    idle_sleep(1, never);  // 500 мкс
+    TEST_ASSERT_EQUAL_UINT32(0, idle_sleptMs());
+    idle_sleep(1, never);  // 1000 мкс
+    TEST_ASSERT_EQUAL_UINT32(1, idle_sleptMs());
+    sim_advance(500);
+    idle_sleep(1, never);  // 500 мкс, всего ровно 2 мс
+    TEST_ASSERT_EQUAL_UINT32(2, idle_sleptMs());
+}
+
+void test_can_sleep_only_when_nothing_pending() {
+    setup();
+    command("M");
+    run(500);
+    last_input_at = millis() - 60000UL;
+    TEST_ASSERT_TRUE(canSleep());
+
+    // Измерение
+    command("R");
+    TEST_ASSERT_FALSE(canSleep());
+    run(1000);
+    last_input_at = millis() - 60000UL;
+    TEST_ASSERT_TRUE(canSleep());
+
+    // Изменение на экране, ещё не отправленное poll()
+    screen.setCursor(0, 1);
+    screen.print('*');
+    TEST_ASSERT_TRUE(screen.isDirty());
+    TEST_ASSERT_FALSE(canSleep());
+    run(500);
+    last_input_at = millis() - 60000UL;
+    TEST_ASSERT_TRUE(canSleep());
+
+    // Пакет из двух измерений (или через 30 с), пока в нём одно. Измерения
+    // по кнопке: ответ на команду сам отправил бы неполный пакет
+    command("B 2 30000 0");
+    click();
+    last_input_at = millis() - 60000UL;
+    TEST_ASSERT_FALSE(serial_batch.isIdle());
+    TEST_ASSERT_FALSE(canSleep());
+    click();
+    last_input_at = millis() - 60000UL;
+    TEST_ASSERT_TRUE(serial_batch.isIdle());
+    TEST_ASSERT_TRUE(canSleep());
+    command("B 1 0 0");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sleep_until_deadline);
+    RUN_TEST(test_wake_ends_sleep_early);
+    RUN_TEST(test_accounting_across_sleeps);
+    RUN_TEST(test_partial_milliseconds_accumulate);
+    RUN_TEST(test_can_sleep_only_when_nothing_pending);
+    return UNITY_END();
+}
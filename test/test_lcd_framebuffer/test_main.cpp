@@ -0,0 +1,180 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <unity.h>
+
+#include "lcd_framebuffer.hpp"
+#include "sim.h"
+
+/*
+    Теневой буфер экрана: отправляются только изменившиеся ячейки.
+    Байты считает заглушка экрана (native/include/LiquidCrystal_I2C.h),
+    в конце - сравнение с прежним выводом показаний напрямую в библиотеку
+*/
+
+static LCD_1602_RUS display(0x27, LCD_COLS, LCD_ROWS);
+
+// Прошивка целиком (src/main.cpp): её экран и пин кнопки энкодера
+void setup();
+void loop();
+extern LCD_1602_RUS lcd;
+const uint8_t ENCODER_SW = 4;
+
+// Все байты экрана: символы и команды
+static uint32_t lcdBytes() { return display.dataBytes + display.commandBytes; }
+
+static void showReading(LcdFramebuffer &screen, const char *text) {
+    screen.setCursor(0, 1);
+    screen.print("                ");
+    screen.setCursor((LCD_COLS - strlen(text)) / 2, 1);
+    screen.print(text);
+    screen.update();
+}
+
+void setUp() {
+    display.clear();
+    display.dataBytes = display.commandBytes = 0;
+}
+
+void tearDown() {}
+
+void test_first_update_redraws_everything() {
+    LcdFramebuffer screen(display, 0x27);
+    screen.print("A");
+    showReading(screen, "#FF8000 orange");
+    TEST_ASSERT_EQUAL_STRING("A               ", display.row(0));
+    TEST_ASSERT_EQUAL_STRING(" #FF8000 orange ", display.row(1));
+    TEST_ASSERT_FALSE(screen.isDirty());
+}
+
+void test_unchanged_frame_sends_nothing() {
+    LcdFramebuffer screen(display, 0x27);
+    showReading(screen, "#FF8000 orange");
+    uint32_t bytes = lcdBytes();
+    showReading(screen, "#FF8000 orange");
+    TEST_ASSERT_EQUAL_UINT32(bytes, lcdBytes());
+}
+
+void test_changed_cells_share_cursor_moves() {
+    LcdFramebuffer screen(display, 0x27);
+    showReading(screen, "#FF8000 orange");
+    uint32_t data = display.dataBytes, commands = display.commandBytes;
+    // Две соседние ячейки - один перенос курсора и два символа
+    showReading(screen, "#FF8120 orange");
+    TEST_ASSERT_EQUAL_UINT32(2, display.dataBytes - data);
+    TEST_ASSERT_EQUAL_UINT32(1, display.commandBytes - commands);
+    TEST_ASSERT_EQUAL_STRING(" #FF8120 orange ", display.row(1));
+    // Две ячейки с разрывом - два переноса
+    data = display.dataBytes, commands = display.commandBytes;
+    showReading(screen, "#0F8121 orange");
+    TEST_ASSERT_EQUAL_UINT32(2, display.dataBytes - data);
+    TEST_ASSERT_EQUAL_UINT32(2, display.commandBytes - commands);
+    TEST_ASSERT_EQUAL_STRING(" #0F8121 orange ", display.row(1));
+}
+
+void test_cyrillic_change_redraws_screen() {
+    LcdFramebuffer screen(display, 0x27);
+    screen.print(L"Пауза");
+    screen.update();
+    uint32_t commands = display.commandBytes;
+    screen.clear();
+    screen.print(L"Цвет");
+    screen.update();
+    // Ячейки CGRAM освобождаются только очисткой экрана
+    TEST_ASSERT_GREATER_THAN(commands, display.commandBytes);
+    TEST_ASSERT_EQUAL_UINT32(0, display.glyphOverflows);
+    TEST_ASSERT_FALSE(screen.isDirty());
+}
+
+// Строка из флеш-памяти выводится так же, как из ОЗУ
+void test_flash_text_matches_wide_string() {
+    LcdFramebuffer screen(display, 0x27);
+    screen.print(L"Чёрный образец");
+    screen.update();
+    // Символы CGRAM начинаются с кода 0, сравниваем строку целиком
+    char expected[LCD_COLS];
+    memcpy(expected, display.row(0), LCD_COLS);
+    display.clear();
+    LcdFramebuffer flash_screen(display, 0x27);
+    flash_screen.print(LF(L"Чёрный образец"));
+    flash_screen.update();
+    TEST_ASSERT_EQUAL(0, memcmp(expected, display.row(0), LCD_COLS));
+    TEST_ASSERT_EQUAL(L'ц', lcd_flashChar(LF(L"цвет"), 0));
+    TEST_ASSERT_EQUAL(0, lcd_flashChar(LF(L"цвет"), 4));
+}
+
+// Проходы loop() прошивки в течение ms мс, по 100 мкс
+static void runFirmware(uint32_t ms) {
+    for (uint32_t i = 0; i < ms * 10; ++i) {
+        loop();
+        sim_advance(100);
+    }
+}
+
+// Ручные измерения по кнопке и по команде R меняют только латиницу во
+// второй строке: полной перерисовки (очистки экрана) нет
+void test_manual_readings_skip_full_redraw() {
+    setup();
+    sim_serialInput("M\n");
+    runFirmware(500);
+    uint32_t clears = lcd.clears, readings = sim_serialReadings();
+    for (uint8_t i = 0; i < 3; ++i) {
+        sim_setPin(ENCODER_SW, LOW);
+        runFirmware(100);
+        sim_setPin(ENCODER_SW, HIGH);
+        runFirmware(1000);
+        TEST_ASSERT_NOT_NULL(strchr(lcd.row(1), '#'));
+    }
+    sim_serialInput("R\n");
+    runFirmware(1000);
+    TEST_ASSERT_EQUAL_UINT32(readings + 4, sim_serialReadings());
+    TEST_ASSERT_EQUAL_UINT32(clears, lcd.clears);
+    TEST_ASSERT_EQUAL_UINT32(0, lcd.glyphOverflows);
+}
+
+// Показания медленно плывут, как у детали на ленте: прежний вывод
+// (очистка строки пробелами и вся строка заново) против теневого буфера
+void test_reading_updates_benchmark() {
+    const uint8_t READINGS = 100;
+    char text[LCD_COLS + 1];
+
+    display.dataBytes = display.commandBytes = 0;
+    for (uint8_t i = 0; i < READINGS; ++i) {
+        snprintf(text, sizeof(text), "#%02X%02X%02X orange", 250 - i / 10,
+                 128 + i % 3, i / 4);
+        display.setCursor(0, 1);
+        display.print("                ");
+        display.setCursor((LCD_COLS - strlen(text)) / 2, 1);
+        display.print(text);
+    }
+    uint32_t direct = lcdBytes();
+
+    LcdFramebuffer screen(display, 0x27);
+    showReading(screen, "#FA8000 orange");
+    display.dataBytes = display.commandBytes = 0;
+    for (uint8_t i = 0; i < READINGS; ++i) {
+        snprintf(text, sizeof(text), "#%02X%02X%02X orange", 250 - i / 10,
+                 128 + i % 3, i / 4);
+        showReading(screen, text);
+    }
+    uint32_t shadow = lcdBytes();
+
+    char message[96];
+    snprintf(message, sizeof(message),
+             "LCD bytes for %u readings: direct %lu, shadow %lu", READINGS,
+             (unsigned long)direct, (unsigned long)shadow);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_UINT32(READINGS * (2 + LCD_COLS + 14), direct);
+    TEST_ASSERT_LESS_OR_EQUAL(direct / 8, shadow);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_update_redraws_everything);
+    RUN_TEST(test_unchanged_frame_sends_nothing);
+    RUN_TEST(test_changed_cells_share_cursor_moves);
+    RUN_TEST(test_cyrillic_change_redraws_screen);
+    RUN_TEST(test_flash_text_matches_wide_string);
+    RUN_TEST(test_manual_readings_skip_full_redraw);
+    RUN_TEST(test_reading_updates_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,150 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <unity.h>
+
+#include "color_transfer.hpp"
+#include "sim.h"
+
+/*
+    Подстройка яркости светодиодов в прошивке на модели фоторезистора:
+    после калибровки уровень каждой цветной фазы за несколько измерений
+    подходит к цели, а цвет при этом не меняется - скважность учитывается
+    при переводе уровня в цвет
+*/
+
+// Прошивка целиком (src/main.cpp), один датчик и три фазы
+void setup();
+void loop();
+extern ColorTransfer transfer[1][3];
+extern uint8_t current_duty[1][3];
+extern uint8_t current_rgb[1][3];
+extern uint16_t current_levels[1][3];
+uint16_t levelTo10Bit(uint16_t level);
+
+const uint16_t TARGET = 512;
+const uint16_t TOLERANCE = 64;
+// Обещано 1-3 измерения, с запасом на шум модели
+const uint8_t MAX_READINGS = 4;
+
+// Проходы loop() в течение ms мс, по 100 мкс (loop() может и поспать)
+static void run(uint32_t ms) {
+    uint64_t until = sim_time() + ms * 1000ULL;
+    while (sim_time() < until) {
+        loop();
+        sim_advance(100);
+    }
+}
+
+static void command(const char *line) {
+    sim_serialInput(line);
+    sim_serialInput("\n");
+    run(100);
+}
+
+// Следующее измерение в автоматическом режиме
+static void nextReading() {
+    uint32_t readings = sim_serialReadings();
+    for (uint16_t i = 0; i < 5000 && sim_serialReadings() == readings; ++i)
+        run(1);
+    TEST_ASSERT_GREATER_THAN(readings, sim_serialReadings());
+}
+
+static uint16_t level(uint8_t slot) {
+    return levelTo10Bit(current_levels[0][slot]);
+}
+
+// Измерения до подхода всех фаз к цели. Возвращает их количество
+static uint8_t converge(uint8_t r, uint8_t g, uint8_t b) {
+    sim_setColor(r, g, b);
+    for (uint8_t reading = 1; reading <= 10; ++reading) {
+        nextReading();
+        bool settled = true;
+        for (uint8_t i = 0; i < 3; ++i)
+            settled = settled && abs((int16_t)level(i) - (int16_t)TARGET) <=
+                                     (int16_t)TOLERANCE;
+        if (settled)
+            return reading;
+    }
+    return 255;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_calibration_enables_ranging() {
+    setup();
+    // Калибровка: по 10 с на образец, затем 4 измерения
+    sim_setColor(255, 255, 255);
+    command("C");
+    run(15000);
+    sim_setColor(0, 0, 0);
+    run(15000);
+    for (uint8_t i = 0; i < 3; ++i)
+        TEST_ASSERT_TRUE(transfer[0][i].isLinearised());
+    command("U 0 0 50");
+    command("A 100");
+}
+
+// Светлый образец при полной яркости далеко ниже цели: яркость снижается
+void test_bright_target_converges() {
+    command("G 0");
+    sim_setColor(240, 230, 220);
+    nextReading();
+    nextReading();
+    for (uint8_t i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL_UINT8(255, current_duty[0][i]);
+        TEST_ASSERT_LESS_THAN(TARGET - TOLERANCE, level(i));
+    }
+    command("G 512");
+    uint8_t readings = converge(240, 230, 220);
+    char message[64];
+    snprintf(message, sizeof(message), "bright: %u readings, duty %u %u %u",
+             readings, current_duty[0][0], current_duty[0][1],
+             current_duty[0][2]);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_READINGS, readings);
+    for (uint8_t i = 0; i < 3; ++i)
+        TEST_ASSERT_LESS_THAN(255, current_duty[0][i]);
+}
+
+// Тёмный образец: яркость остаётся выше, чем у светлого, и тоже подходит
+void test_dark_target_converges() {
+    uint8_t bright_duty = current_duty[0][0];
+    uint8_t readings = converge(90, 80, 70);
+    char message[64];
+    snprintf(message, sizeof(message), "dark: %u readings, duty %u %u %u",
+             readings, current_duty[0][0], current_duty[0][1],
+             current_duty[0][2]);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_READINGS, readings);
+    TEST_ASSERT_GREATER_THAN(bright_duty, current_duty[0][0]);
+}
+
+// Цвет по уровню при сниженной яркости тот же, что и при полной
+void test_duty_feeds_normalisation() {
+    const uint8_t COLORS[][3] = {{240, 230, 220}, {160, 150, 140}};
+    for (uint8_t c = 0; c < 2; ++c) {
+        command("G 0");
+        sim_setColor(COLORS[c][0], COLORS[c][1], COLORS[c][2]);
+        nextReading();
+        nextReading();
+        uint8_t full[3];
+        memcpy(full, current_rgb[0], sizeof(full));
+        command("G 512");
+        converge(COLORS[c][0], COLORS[c][1], COLORS[c][2]);
+        nextReading();
+        TEST_ASSERT_LESS_THAN(255, current_duty[0][0]);
+        for (uint8_t i = 0; i < 3; ++i)
+            TEST_ASSERT_UINT_WITHIN(4, full[i], current_rgb[0][i]);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_calibration_enables_ranging);
+    RUN_TEST(test_bright_target_converges);
+    RUN_TEST(test_dark_target_converges);
+    RUN_TEST(test_duty_feeds_normalisation);
+    return UNITY_END();
+}
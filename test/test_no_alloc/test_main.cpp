@@ -0,0 +1,135 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <new>
+
+#include "sim.h"
+
+/*
+    Рабочие пути прошивки не выделяют память: вывод в Serial, вывод на
+    экран, разбор и выполнение команд. Считаются все вызовы operator new
+    и malloc() после setup(); в glibc malloc() подменяется, настоящий -
+    __libc_malloc()
+*/
+
+void setup();
+void loop();
+
+static bool counting = false;
+static uint32_t allocations = 0;
+
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+
+extern "C" void *malloc(size_t size) {
+    allocations += counting;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+    allocations += counting;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size) {
+    allocations += counting;
+    return __libc_realloc(pointer, size);
+}
+
+static void *rawAllocate(size_t size) { return __libc_malloc(size); }
+#else
+static void *rawAllocate(size_t size) { return std::malloc(size); }
+#endif
+
+void *operator new(size_t size) {
+    allocations += counting;
+    void *pointer = rawAllocate(size ? size : 1);
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+// operator delete остаётся стандартным: он освобождает через free()
+
+// Проходы loop() в течение ms мс виртуального времени, по 100 мкс
+static void run(uint32_t ms) {
+    for (uint32_t i = 0; i < ms * 10; ++i) {
+        loop();
+        sim_advance(100);
+    }
+}
+
+// Команда по Serial и время на её выполнение и вывод
+static void command(const char *line) {
+    sim_serialInput(line);
+    sim_serialInput("\n");
+    run(300);
+}
+
+void setUp() {
+    allocations = 0;
+    counting = true;
+}
+
+void tearDown() { counting = false; }
+
+// Подмена действительно видит выделения
+void test_counter_sees_allocations() {
+    delete new int;
+    free(malloc(16));
+    counting = false;
+    TEST_ASSERT_EQUAL_UINT32(2, allocations);
+}
+
+void test_auto_readings() {
+    uint32_t readings = sim_serialReadings();
+    run(3000);
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+    TEST_ASSERT_GREATER_THAN(readings, sim_serialReadings());
+}
+
+void test_serial_formats_and_spaces() {
+    static const char *const COMMANDS[] = {
+        "S 1 1", "S 2 2", "S 3 3", "F 1", "F 2", "F 3",
+        "B 4 200 1", "F 0", "B 1 0 0", "S 0 0", "Q", "H"};
+    for (const char *line : COMMANDS)
+        command(line);
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+void test_settings_commands() {
+    static const char *const COMMANDS[] = {
+        "O 64 5 12", "W 20 1 3", "E 4 32", "G 400", "D 200",
+        "U 8 300 50", "O 0 7 10", "U 0 0 50", "X", "A 99999999999",
+        "D -1", "Q"};
+    for (const char *line : COMMANDS)
+        command(line);
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+void test_modes_and_calibration() {
+    command("M");
+    command("R");
+    run(500);
+    command("P");
+    command("P");
+    command("A 100");
+    // Калибровка: по 10 с на каждый образец и время на считывание
+    command("C");
+    run(25000);
+    command("Q");
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+int main() {
+    setup();
+    UNITY_BEGIN();
+    RUN_TEST(test_counter_sees_allocations);
+    RUN_TEST(test_auto_readings);
+    RUN_TEST(test_serial_formats_and_spaces);
+    RUN_TEST(test_settings_commands);
+    RUN_TEST(test_modes_and_calibration);
+    return UNITY_END();
+}
@@ -0,0 +1,171 @@
+#include <Arduino.h>
+#include <GyverTimer.h>
+#include <unity.h>
+
+#include "sim.h"
+
+/*
+    GScheduler у переполнения millis(): часы стартуют за 16 мс до 2^32,
+    сроки по обе стороны от нуля должны идти по порядку и наступать вовремя.
+    В конце - прошивка: смена задержки энкодером переносит ожидаемое
+    измерение
+*/
+
+const uint32_t START_MS = 0xFFFFFFF0;
+
+static GScheduler scheduler;
+static char fired[GSCHEDULER_TASKS + 1];
+static uint8_t fired_count;
+
+static void record(char name) {
+    if (fired_count < GSCHEDULER_TASKS)
+        fired[fired_count++] = name;
+}
+
+static void taskA() { record('A'); }
+static void taskB() { record('B'); }
+static void taskC() { record('C'); }
+static void taskD() { record('D'); }
+
+static void advanceMs(uint32_t ms) { sim_advance(ms * 1000UL); }
+
+void setUp() {
+    sim_setUptime((uint64_t)START_MS * 1000 - sim_time());
+    scheduler.cancel(taskA);
+    scheduler.cancel(taskB);
+    scheduler.cancel(taskC);
+    scheduler.cancel(taskD);
+    memset(fired, 0, sizeof(fired));
+    fired_count = 0;
+}
+
+void tearDown() {}
+
+// Поставлены в обратном порядке, срок C и D уже после переполнения
+void test_order_across_wrap() {
+    TEST_ASSERT_EQUAL_UINT32(START_MS, millis());
+    TEST_ASSERT_TRUE(scheduler.schedule(taskD, 40));
+    TEST_ASSERT_TRUE(scheduler.schedule(taskC, 20));
+    TEST_ASSERT_TRUE(scheduler.schedule(taskB, 10));
+    TEST_ASSERT_TRUE(scheduler.schedule(taskA, 5));
+    TEST_ASSERT_FALSE(scheduler.schedule([] {}, 1));
+    TEST_ASSERT_EQUAL_UINT32(5, scheduler.nextWakeup());
+
+    for (uint8_t ms = 0; ms < 60; ++ms) {
+        scheduler.tick();
+        advanceMs(1);
+    }
+    TEST_ASSERT_EQUAL_STRING("ABCD", fired);
+}
+
+// Каждая задача наступает ровно в свой срок, не раньше и не позже
+void test_fires_on_time_across_wrap() {
+    scheduler.schedule(taskA, 15);  // 0xFFFFFFFF
+    scheduler.schedule(taskB, 16);  // 0
+    scheduler.schedule(taskC, 17);  // 1
+
+    advanceMs(14);
+    TEST_ASSERT_EQUAL_UINT8(0, scheduler.tick());
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.nextWakeup());
+
+    advanceMs(1);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFF, millis());
+    TEST_ASSERT_EQUAL_UINT8(1, scheduler.tick());
+    TEST_ASSERT_EQUAL_STRING("A", fired);
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.nextWakeup());
+
+    advanceMs(1);
+    TEST_ASSERT_EQUAL_UINT32(0, millis());
+    TEST_ASSERT_EQUAL_UINT8(1, scheduler.tick());
+    TEST_ASSERT_EQUAL_STRING("AB", fired);
+
+    advanceMs(1);
+    TEST_ASSERT_EQUAL_UINT8(1, scheduler.tick());
+    TEST_ASSERT_EQUAL_STRING("ABC", fired);
+    TEST_ASSERT_EQUAL_UINT32(GSCHEDULER_IDLE, scheduler.nextWakeup());
+}
+
+// Пропущенный срок до переполнения не ждёт ещё 49 суток
+void test_overdue_across_wrap() {
+    scheduler.schedule(taskA, 8);
+    scheduler.schedule(taskB, 30);
+    advanceMs(24);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.nextWakeup());
+    TEST_ASSERT_EQUAL_UINT8(1, scheduler.tick());
+    TEST_ASSERT_EQUAL_UINT32(6, scheduler.nextWakeup());
+    TEST_ASSERT_TRUE(scheduler.isScheduled(taskB));
+    advanceMs(6);
+    TEST_ASSERT_EQUAL_UINT8(1, scheduler.tick());
+    TEST_ASSERT_EQUAL_STRING("AB", fired);
+}
+
+// Перенос задачи через ноль меняет её место в очереди
+void test_reschedule_across_wrap() {
+    scheduler.schedule(taskA, 10);
+    scheduler.schedule(taskB, 20);
+    advanceMs(8);
+    scheduler.schedule(taskA, 30);  // теперь позже B
+    TEST_ASSERT_EQUAL_UINT32(12, scheduler.nextWakeup());
+    for (uint8_t ms = 0; ms < 40; ++ms) {
+        scheduler.tick();
+        advanceMs(1);
+    }
+    TEST_ASSERT_EQUAL_STRING("BA", fired);
+}
+
+// Прошивка целиком (src/main.cpp)
+void setup();
+void loop();
+
+// Проходы loop() в течение ms мс, по 100 мкс (loop() может и поспать)
+static void run(uint32_t ms) {
+    uint64_t until = sim_time() + ms * 1000ULL;
+    while (sim_time() < until) {
+        loop();
+        sim_advance(100);
+    }
+}
+
+static void command(const char *line) {
+    sim_serialInput(line);
+    sim_serialInput("\n");
+    run(100);
+}
+
+// Поворот энкодера налево (CLK - 2, DT - 3): 11 -> 01 -> 00 -> 10 -> 11
+static void turnLeft() {
+    sim_setPin(3, LOW);
+    sim_setPin(2, LOW);
+    sim_setPin(3, HIGH);
+    sim_setPin(2, HIGH);
+    loop();
+    sim_advance(100);
+}
+
+// Задержку 10 с уменьшили до минимальной сразу после измерения: следующее
+// идёт через неё, а не через прежние 10 с
+void test_encoder_delay_reschedules_reading() {
+    setup();
+    command("U 0 0 50");
+    command("A 10000");
+    // Первое измерение сразу после включения режима
+    run(1000);
+    uint32_t readings = sim_serialReadings();
+    // С нажатой кнопкой шаг 500 мс, и прошивка не засыпает между поворотами
+    sim_setPin(4, LOW);
+    for (uint8_t i = 0; i < 20; ++i)
+        turnLeft();
+    sim_setPin(4, HIGH);
+    run(1500);
+    TEST_ASSERT_GREATER_THAN(readings, sim_serialReadings());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_order_across_wrap);
+    RUN_TEST(test_fires_on_time_across_wrap);
+    RUN_TEST(test_overdue_across_wrap);
+    RUN_TEST(test_reschedule_across_wrap);
+    RUN_TEST(test_encoder_delay_reschedules_reading);
+    return UNITY_END();
+}
@@ -0,0 +1,83 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "serial_command.hpp"
+
+/*
+    Разбор строк команд по байтам: аргументы, знак, ошибки и переход к
+    следующей строке после ошибочной
+*/
+
+static CommandParser parser;
+
+// Подать строку; true - команда принята на последнем байте
+static bool feed(const char *line) {
+    bool complete = false;
+    while (*line)
+        complete = parser.feed(*line++);
+    return complete;
+}
+
+void setUp() { parser = CommandParser(); }
+
+void tearDown() {}
+
+void test_arguments() {
+    TEST_ASSERT_TRUE(feed("o 64, 5\t-13\n"));
+    TEST_ASSERT_EQUAL('O', parser.command());
+    TEST_ASSERT_TRUE(parser.valid());
+    TEST_ASSERT_EQUAL(3, parser.argCount());
+    TEST_ASSERT_EQUAL_INT32(64, parser.arg(0));
+    TEST_ASSERT_EQUAL_INT32(5, parser.arg(1));
+    TEST_ASSERT_EQUAL_INT32(-13, parser.arg(2));
+    TEST_ASSERT_EQUAL_INT32(7, parser.arg(3, 7));
+}
+
+void test_sign_without_digits() {
+    TEST_ASSERT_TRUE(feed("D -\n"));
+    TEST_ASSERT_FALSE(parser.valid());
+    TEST_ASSERT_EQUAL(0, parser.argCount());
+    TEST_ASSERT_TRUE(feed("D 1 - 2\n"));
+    TEST_ASSERT_FALSE(parser.valid());
+    TEST_ASSERT_TRUE(feed("D --1\n"));
+    TEST_ASSERT_FALSE(parser.valid());
+    // Знак перед цифрами по-прежнему допустим, и ошибка не переходит
+    // на следующую строку
+    TEST_ASSERT_TRUE(feed("D -1\n"));
+    TEST_ASSERT_TRUE(parser.valid());
+    TEST_ASSERT_EQUAL(1, parser.argCount());
+    TEST_ASSERT_EQUAL_INT32(-1, parser.arg(0));
+}
+
+void test_errors() {
+    TEST_ASSERT_TRUE(feed("A 1x\n"));
+    TEST_ASSERT_FALSE(parser.valid());
+    TEST_ASSERT_TRUE(feed("A 1 2 3 4 5\n"));
+    TEST_ASSERT_FALSE(parser.valid());
+    TEST_ASSERT_TRUE(feed("A 1234567890\n"));
+    TEST_ASSERT_FALSE(parser.valid());
+    TEST_ASSERT_TRUE(feed("5\n"));
+    TEST_ASSERT_FALSE(parser.valid());
+    TEST_ASSERT_TRUE(feed("A 123456789\n"));
+    TEST_ASSERT_TRUE(parser.valid());
+    TEST_ASSERT_EQUAL_INT32(123456789, parser.arg(0));
+}
+
+void test_empty_lines() {
+    TEST_ASSERT_FALSE(feed("\r\n  \n"));
+    TEST_ASSERT_TRUE(feed("r\r"));
+    TEST_ASSERT_EQUAL('R', parser.command());
+    TEST_ASSERT_EQUAL(0, parser.argCount());
+    TEST_ASSERT_TRUE(parser.valid());
+    // '\n' после '\r' не даёт второй команды
+    TEST_ASSERT_FALSE(feed("\n"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_arguments);
+    RUN_TEST(test_sign_without_digits);
+    RUN_TEST(test_errors);
+    RUN_TEST(test_empty_lines);
+    return UNITY_END();
+}
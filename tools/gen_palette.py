@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Генератор таблицы именованных цветов (src/color_palette.cpp).
+
+Читает CSV со столбцами name,hex[,label] (например "red,#FF0000"); label -
+короткое название для экрана, без него name обрезается до NAME_LENGTH.
+Переводит цвета в L*a*b* (D65, x100 - как color_toLab() на плате) и
+раскладывает их в сбалансированное k-d дерево без указателей: в каждом
+диапазоне [lo, hi)
+средний элемент - узел, делящий по оси (L*, a*, b* по очереди от глубины),
+левее - меньшие значения, правее - большие. Поиск по такому массиву
+(colornames_find) не требует ни ОЗУ, ни ссылок между узлами.
+
+    python3 tools/gen_palette.py tools/css_colors.csv -o src/color_palette.cpp
+"""
+
+import argparse
+import csv
+import os
+import sys
+
+# Должно совпадать с COLOR_NAME_LENGTH в src/color_names.hpp
+NAME_LENGTH = 8
+
+WHITE = (0.95047, 1.0, 1.08883)
+MATRIX = ((0.4124564, 0.3575761, 0.1804375),
+          (0.2126729, 0.7151522, 0.0721750),
+          (0.0193339, 0.1191920, 0.9503041))
+
+
+def srgb_to_linear(c):
+    c /= 255
+    return c / 12.92 if c <= 0.04045 else ((c + 0.055) / 1.055) ** 2.4
+
+
+def lab_f(t):
+    return t ** (1 / 3) if t > (6 / 29) ** 3 else t * 841 / 108 + 4 / 29
+
+
+def rgb_to_lab(r, g, b):
+    linear = [srgb_to_linear(c) for c in (r, g, b)]
+    fx, fy, fz = (lab_f(sum(m * c for m, c in zip(row, linear)) / w)
+                  for row, w in zip(MATRIX, WHITE))
+    return (round((116 * fy - 16) * 100), round(500 * (fx - fy) * 100),
+            round(200 * (fy - fz) * 100))
+
+
+def read_palette(path, name_length):
+    colors = []
+    names = set()
+    with open(path, newline='') as f:
+        for row in csv.DictReader(f):
+            name = (row.get('label') or row['name']).strip()[:name_length]
+            value = row['hex'].strip().lstrip('#')
+            if len(value) != 6:
+                sys.exit('%s: bad colour "%s"' % (path, row['hex']))
+            if name in names:
+                print('warning: duplicate name "%s" after truncation' % name,
+                      file=sys.stderr)
+            names.add(name)
+            rgb = tuple(int(value[i:i + 2], 16) for i in (0, 2, 4))
+            colors.append((rgb_to_lab(*rgb), name, rgb))
+    if not colors or len(colors) > 0xFFFF:
+        sys.exit('%s: expected 1..65535 colours' % path)
+    return colors
+
+
+def build_tree(colors, depth=0):
+    if not colors:
+        return []
+    axis = depth % 3
+    colors = sorted(colors, key=lambda c: c[0][axis])
+    middle = len(colors) // 2
+    return (build_tree(colors[:middle], depth + 1) + [colors[middle]] +
+            build_tree(colors[middle + 1:], depth + 1))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('palette', help='CSV: name,hex[,label]')
+    parser.add_argument('-o', '--output', default='src/color_palette.cpp')
+    args = parser.parse_args()
+
+    tree = build_tree(read_palette(args.palette, NAME_LENGTH))
+    lines = [
+        '// Создано tools/gen_palette.py из %s, не редактировать вручную'
+        % os.path.basename(args.palette),
+        '#include "color_names.hpp"',
+        '',
+        '// k-d дерево в L*a*b* x100, см. color_names.hpp',
+        'const NamedColor NAMED_COLORS[] PROGMEM = {',
+    ]
+    for (l, a, b), name, rgb in tree:
+        lines.append('    {{%d, %d, %d}, "%s"},  // #%02X%02X%02X'
+                     % ((l, a, b, name) + rgb))
+    lines[-1] = lines[-1].replace('},  //', '}  //')
+    lines += [
+        '};',
+        '',
+        'const uint16_t NAMED_COLORS_COUNT =',
+        '    sizeof(NAMED_COLORS) / sizeof(NAMED_COLORS[0]);',
+        '',
+    ]
+    with open(args.output, 'w') as f:
+        f.write('\n'.join(lines))
+
+
+if __name__ == '__main__':
+    main()